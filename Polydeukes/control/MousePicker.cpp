@@ -13,6 +13,8 @@ int MousePicker::mousePositionX{};
 int MousePicker::mousePositionY{};
 void (*MousePicker::mousePositionCallback)(GLFWwindow*,double,double) = [](GLFWwindow* window, double d, double d2) {};
 Ray MousePicker::ray{};
+std::vector<std::pair<float, int>> MousePicker::sceneCandidates{};
+std::unique_ptr<PickingBuffer> MousePicker::pickingBuffer{};
 Renderer* MousePicker::renderer{};
 Camera* MousePicker::camera{};
 Scene* MousePicker::theScene{};
@@ -42,12 +44,6 @@ glm::vec3 LineDrawer::computeNewLocation(double mousePosX, double mousePosY, glm
     MousePicker::mousePositionX = mousePosX;
     MousePicker::mousePositionY = mousePosY;
     MousePicker::computeWorldRay();
-    std::vector<std::tuple<std::shared_ptr<Shape>, glm::vec3>> candidates = MousePicker::computeRayTriangleCollisions();
-    std::sort(candidates.begin(), candidates.end(), [](auto e, auto e2) {
-        glm::vec4 res1 = camera->viewingTransformation() * glm::vec4(std::get<1>(e), 1.0f);
-        glm::vec4 res2 = camera->viewingTransformation() * glm::vec4(std::get<1>(e2), 1.0f);
-        return res2.z < res1.z;
-    });
     glm::vec3 delta = lineData.endPosition - initialPosition;
     glm::vec3 planeNormal;
     if (glm::length(delta) < 1e-4f) {
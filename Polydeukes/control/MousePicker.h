@@ -11,16 +11,19 @@
 #include <glm.hpp>
 #include "../view/renderer.h"
 #include "../view/ScreenHeight.h"
+#include "../view/pickingbuffer.h"
 #include "../model/Camera.h"
 #include "../model/Scene.h"
 #include "../model/shape.h"
 #include "Arcball.h"
 #include "../model/vector.h"
+#include "../model/bvh.h"
 
 #include <vector>
 #include <algorithm>
 #include <tuple>
 #include <functional>
+#include <memory>
 
 /*
  the top level mouse control module is the picker, from there we can decide which control we want
@@ -146,6 +149,19 @@ public:
         glfwSetCursorPosCallback(window, mousePositionCallback);
     }
     
+    /*
+     Picks off an id buffer the renderer draws every frame (see PickingBuffer) rather than by casting rays, so a
+     hover costs the same whatever the triangle count. The answer is a frame behind the cursor.
+     idProgram is idvs.glsl/idfs.glsl, initialized.
+     */
+    virtual void enableGPUPicker(GLFWwindow* window, ShaderProgram* idProgram) {
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        mousePositionCallback = gpu_picking_callback;
+        glfwSetCursorPosCallback(window, mousePositionCallback);
+        pickingBuffer = std::make_unique<PickingBuffer>(idProgram);
+        renderer->setOffscreenPass(renderPickingBuffer);
+    }
+    
     static Ray computeMouseRay(int mousePosX, int mousePosY) {
         float x = (2.0f * mousePosX) / ScreenHeight::screen_width - 1.0f;
         float y = 1.0f - (2.0f * mousePosY) / ScreenHeight::screen_height;
@@ -182,6 +198,9 @@ private:
     static int mousePositionX;
     static int mousePositionY;
     static Ray ray;
+    //(entry distance, shape) for the shapes whose boxes the ray goes through, reused between queries
+    static std::vector<std::pair<float, int>> sceneCandidates;
+    static std::unique_ptr<PickingBuffer> pickingBuffer;
     static MouseRayCollision collisionData;
     static std::shared_ptr<Shape> currentlySelectedShape;
     static std::function<void(double,double)> clickCustomization;
@@ -194,21 +213,39 @@ private:
         MousePicker::ray.origin = mouseRay.origin;
     }
     
-    static std::vector<std::tuple<std::shared_ptr<Shape>, glm::vec3>> computeRayTriangleCollisions() {
-        std::vector<std::tuple<std::shared_ptr<Shape>, glm::vec3>> candidates;
+    /*
+     Nearest shape under the ray. A linear slab test over the shapes' (cached) world boxes, nearest box first,
+     and each shape tests the ray against its own triangle BVH in model space. Shapes whose boxes start past the
+     closest hit so far are never opened. Things move every frame, so a BVH over the boxes would have to be
+     rebuilt per query, which costs more than this scan does.
+     */
+    static bool computeNearestRayTriangleCollision(MouseRayCollision& collision) {
         std::vector<std::shared_ptr<Shape>> sceneItems = theScene->get();
-        for (auto&& shape : sceneItems) {
-            constexpr float epsilon = std::numeric_limits<float>::epsilon();
-            std::vector<glm::vec3> triangles = shape->getPositions();
-            for (int i = 0; i < triangles.size(); i+=3) {
-                Triangle triangle(triangles[i], triangles[i+1], triangles[i+2]);
-                auto result = vector::rayTriangleIntersection(ray, triangle);
-                for (auto res : result) {
-                    candidates.push_back(std::make_tuple(shape, res));
-                }
+        glm::vec3 inverseDirection = 1.0f / ray.direction;
+        RayHit nearest{};
+        sceneCandidates.clear();
+        for (size_t i = 0; i < sceneItems.size(); ++i) {
+            float entry = AABB(sceneItems[i]->getAABB()).intersect(ray.origin, inverseDirection, nearest.t);
+            if (entry != std::numeric_limits<float>::infinity()) {
+                sceneCandidates.emplace_back(entry, (int)i);
             }
         }
-        return candidates;
+        std::sort(sceneCandidates.begin(), sceneCandidates.end());
+        int nearestShape = -1;
+        for (const auto& [entry, shape] : sceneCandidates) {
+            if (entry > nearest.t) {
+                break;
+            }
+            if (sceneItems[shape]->intersectRay(ray, nearest)) {
+                nearestShape = shape;
+            }
+        }
+        if (nearestShape < 0) {
+            return false;
+        }
+        collision.targetShape = sceneItems[nearestShape];
+        collision.exactPosition = nearest.position;
+        return true;
     }
     
     static std::vector<std::tuple<std::shared_ptr<Shape>, glm::vec3>> computeCollisions() {
@@ -349,18 +386,37 @@ private:
         mousePositionX = xpos;
         mousePositionY = ypos;
         computeWorldRay();
-        std::vector<std::tuple<std::shared_ptr<Shape>, glm::vec3>> candidates = computeRayTriangleCollisions();
-        std::sort(candidates.begin(), candidates.end(), [](auto e, auto e2) {
-            glm::vec4 res1 = camera->viewingTransformation() * glm::vec4(std::get<1>(e), 1.0f);
-            glm::vec4 res2 = camera->viewingTransformation() * glm::vec4(std::get<1>(e2), 1.0f);
-            return res2.z < res1.z;
-        });
-        if (candidates.size() == 0) {
+        if (!computeNearestRayTriangleCollision(collisionData)) {
             resetCollisionData(collisionData);
-            return;
         }
-        collisionData.targetShape = std::get<0>(candidates.front());
-        collisionData.exactPosition = std::get<1>(candidates.front());
+    }
+    
+    //the picking itself happens in renderPickingBuffer, all we need is where the cursor is
+    static void gpu_picking_callback(GLFWwindow* window, double xpos, double ypos) {
+        mousePositionX = xpos;
+        mousePositionY = ypos;
+        computeWorldRay();
+    }
+    
+    /*
+     Collects whichever earlier frame's pick has come back, then draws this frame's ids and queues the read under
+     the cursor. Hover only changes when the target does.
+     */
+    static void renderPickingBuffer() {
+        PickingBuffer::Pick pick{};
+        if (pickingBuffer->resolve(pick)) {
+            if (pick.shape != collisionData.targetShape) {
+                if (collisionData.targetShape) {
+                    collisionData.targetShape->offHover();
+                }
+                if (pick.shape) {
+                    pick.shape->onHover();
+                }
+            }
+            collisionData.targetShape = pick.shape;
+            collisionData.exactPosition = pick.shape ? pick.position : glm::vec3(0.0f);
+        }
+        pickingBuffer->render(theScene->get(), renderer->getViewingTransform(), renderer->getProjectionTransform(), mousePositionX, mousePositionY);
     }
     
     static void mouse_position_callback(GLFWwindow* window, double xpos, double ypos) {
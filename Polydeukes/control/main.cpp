@@ -33,12 +33,17 @@
 #include "../model/ttfinterpreter.h"
 #include "../model/textbox.h"
 #include "../model/armature.h"
+#include "../model/instancedbatch.h"
+#include "../model/broadphase.h"
+#include "../model/particlesystem.h"
+#include "../model/crosssection.h"
 
 #include <glm.hpp>
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 #include <functional>
 #include <stack>
+#include <iomanip>
 
 /*
  TODO: need an undo button.
@@ -386,6 +391,7 @@ void renderMotionCaptureScene(GLFWwindow* window) {
     picker.enable(window);
     std::string bvhFile = "/Users/lawrenceberardelli/Documents/bvh_sample_files/cowboy.bvh";
     std::shared_ptr<SceneGraph> graph(new SceneGraph(bvhFile));
+    graph->setClock(&renderer.getClock());
     renderer.addMesh(std::dynamic_pointer_cast<Shape>(graph), &program);
     renderer.buildandrender(window, &camera, &theScene);
 }
@@ -545,9 +551,7 @@ void renderBasicSplineStudy(GLFWwindow* window) {
     ShaderProgram glyphProgram(getShaderDirectory() + "glyphvs.glsl", getShaderDirectory() + "glyphfs.glsl");
     glyphProgram.init();
     auto manager = FontLoader::loadFont(font, {});
-//    while (!manager->bReady) {
-//        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-//    }
+//    manager->waitUntilReady();
     MousePicker picker = MousePicker(&renderer, &camera, &theScene, [&](double mousePosx, double mousePosy) {
         Ray mouseRay = MousePicker::computeMouseRay(mousePosx, mousePosy);
         Plane plane(camera.getDirection(), glm::vec3(0.f,0.f,0.f));
@@ -1109,9 +1113,7 @@ void ttfInterpreter(GLFWwindow* window) {
     auto manager = FontLoader::loadFont(font, {});
     MousePicker picker = MousePicker(&renderer, &camera, &theScene, [](double,double){}, [](double x,double y){});
     picker.enable(window);
-    while (!manager->bReady) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-    }
+    manager->waitUntilReady();
     auto grid = std::shared_ptr<Grid>(new Grid(corners[0], corners[1], font.unitsPerEm / 10.f));
     int j = 0;
     int i = 0;
@@ -1242,9 +1244,7 @@ void renderTextEditor(GLFWwindow* window) {
         arcball.registerRotationCallback(window, x, y);
     });
     auto manager = FontLoader::loadFont(font, {});
-    while (!manager->bReady) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    }
+    manager->waitUntilReady();
     std::shared_ptr<Shape> textBox = std::make_unique<TextBox>(window, manager, 10, 5, &glyphProgram);
     std::dynamic_pointer_cast<TextBox>(textBox)->initReferenceToThis();
     renderer.addMesh(textBox, {&program, &glyphProgram});
@@ -1315,9 +1315,7 @@ void renderTileDataInterpreter(GLFWwindow* window) {
     MeshDragger::camera = &camera;
     picker.enable(window);
     auto manager = FontLoader::loadFont(font, {});
-    while (!manager->bReady) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    }
+    manager->waitUntilReady();
     std::shared_ptr<ScrollBox> scrollBox = std::make_unique<ScrollBox>(window, manager, 10, 0.5);
     scrollBox->initReferenceToThis();
     scrollBox->setModelingTransform(glm::translate(glm::mat4(1.0f), glm::vec3(0.f,0.f,.5f)));
@@ -1426,9 +1424,7 @@ void renderFontShapes(GLFWwindow* window) {
         arcball.registerRotationCallback(window, x, y);
     });
     auto manager = FontLoader::loadFont(font, {});
-    while (!manager->bReady) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    }
+    manager->waitUntilReady();
     std::shared_ptr<Shape> sphere = std::make_unique<WordCircle>(manager);
     renderer.addMesh(sphere);
     renderer.addMesh(CubeBuilder().build(), &program);
@@ -2425,12 +2421,16 @@ void GameBoyInterpreter(GLFWwindow* window) {
 void chipEightInterpreter(GLFWwindow* window) {
     ShaderProgram program(getShaderDirectory() + "vertexshader.glsl", getShaderDirectory() + "chip8fragmentshader.glsl");
     program.init();
+    ShaderProgram instancedProgram(getShaderDirectory() + "instancedshapevs.glsl", getShaderDirectory() + "chip8instancedfs.glsl");
+    instancedProgram.init();
     Camera camera(glm::vec3(0.0f,0.0f,35.f), glm::vec3(0.0f,0.0f,0.0f));
     Scene theScene{};
     Renderer renderer(&theScene,&program);
     
     //define the 64x32 display
     std::array<std::shared_ptr<Shape>, 2048> display{};
+    //the pixels stay in the scene for picking but are drawn in one call through the batch
+    std::shared_ptr<InstancedBatch> displayBatch{};
     //hack based on hard coded fov and aspect ratio from the renderer
     glm::vec3 center = glm::vec3(-25.37, 14.04, 0.f);
     for (int i = 0; i < 32; ++i) {
@@ -2441,11 +2441,16 @@ void chipEightInterpreter(GLFWwindow* window) {
             tmp->setModelingTransform(glm::scale(glm::mat4(1.0f), glm::vec3(.805415260f,.906092f, 1.f)));
             tmp->updateModellingTransform(glm::translate(glm::mat4(1.0f), center));
             center = glm::vec3(center.x + .805415260f, center.y, center.z);
-            renderer.addMesh(tmp);
+            if (!displayBatch) {
+                displayBatch = std::make_shared<InstancedBatch>(tmp);
+            }
+            displayBatch->add(tmp);
+            theScene.addMesh(tmp);
             display[i*64+j] = tmp;
         }
         center = glm::vec3(-25.37, center.y - .906092f, 0.f);
     }
+    renderer.addMesh(displayBatch, &instancedProgram);
     
     //define the memory
     std::array<unsigned int, 4096> ram{};
@@ -2524,6 +2529,38 @@ std::vector<int> parseFaceLine(std::string delim, std::string line) {
     return face;
 }
 
+/*
+ A fountain of small cubes drawn with one instanced call, stepped by the bulk ParticleSystem rather than one
+ Particle each. Particles that fall out of the 50 unit boundary are dropped like the playground's.
+ */
+void renderParticleFountain(GLFWwindow* window) {
+    ShaderProgram program(getShaderDirectory() + "vertexshader.glsl", getShaderDirectory() + "fragmentshader.glsl");
+    program.init();
+    ShaderProgram particleProgram(getShaderDirectory() + "particlevs.glsl", getShaderDirectory() + "fragmentshader.glsl");
+    particleProgram.init();
+    Camera camera(glm::vec3(0.0f,10.f,60.f), glm::vec3(0.0f,0.0f,0.0f));
+    Arcball arcball(&camera);
+    arcball.enable(window);
+    Scene theScene{};
+    Renderer renderer(&theScene,&program);
+    std::shared_ptr<Shape> prototype = CubeBuilder().build();
+    prototype->setModelingTransform(glm::scale(glm::mat4(1.0f), glm::vec3(0.1f)));
+    auto fountain = std::make_shared<ParticleSystem>(prototype);
+    fountain->setColour(glm::vec3(0.3f, 0.6f, 1.0f));
+    fountain->setGravity();
+    fountain->setDrag(0.1f, 0.01f);
+    const int nParticles = 100000;
+    fountain->reserve(nParticles);
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> spread(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> lift(30.0f, 45.0f);
+    for (int i = 0; i < nParticles; ++i) {
+        fountain->addParticle(glm::vec3(0.0f), 1.0f, glm::vec3(spread(generator), lift(generator), spread(generator)));
+    }
+    renderer.addParticleSystem(fountain, &particleProgram);
+    renderer.buildandrender(window, &camera, &theScene);
+}
+
 void objFileInterpeter(GLFWwindow* window) {
     std::string objFile = "/Users/lawrenceberardelli/Downloads/hand.obj";
     ShaderProgram program(getShaderDirectory() + "vertexshader.glsl", getShaderDirectory() + "fragmentshader.glsl");
@@ -2534,12 +2571,15 @@ void objFileInterpeter(GLFWwindow* window) {
     arcball.enable(window);
     Scene theScene{};
     Renderer renderer(&theScene,&program);
-    std::shared_ptr<Shape> shape = objInterpreter::interpretObjFile(objFile);
+    //the window comes up straight away, the hand shows as its box while it loads
+    std::shared_ptr<Shape> shape = renderer.getStreamer().loadObj(objFile);
     renderer.addMesh(shape);
     MousePicker picker = MousePicker(&renderer, &camera, &theScene, [&](double mosPosx, double mosPosy) {
         arcball.registerRotationCallback(window, mosPosx, mosPosy);
     });
-    picker.enableRayTrianglePicker(window);
+    ShaderProgram idProgram(getShaderDirectory() + "idvs.glsl", getShaderDirectory() + "idfs.glsl");
+    idProgram.init();
+    picker.enableGPUPicker(window, &idProgram);
     renderer.buildandrender(window, &camera, &theScene);
 }
 
@@ -2568,63 +2608,41 @@ void riggingModule(GLFWwindow* window) {
         LineDrawer::registerMousePositionCallback(window, exactPosition, fillcpy);
         bones.push_back(fillcpy);
     });
+    std::vector<std::future<void>> crossSectionJobs{};
     shape->setOnMouseUp([&](std::weak_ptr<Shape> theShape) {
         glm::vec3 endPosition = LineDrawer::lineData.endPosition;
         glm::vec3 startPosition = LineDrawer::lineData.startPosition;
-        glm::vec3 direction = glm::normalize(endPosition - startPosition);
-        glm::vec3 arbitrary = (fabs(direction.x) > 0.1f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
-        glm::vec3 u = glm::normalize(glm::cross(direction, arbitrary));
-        glm::vec3 v = glm::cross(direction, u);
-        struct RayShapePair {
-            Ray ray{};
-            std::shared_ptr<Shape> shape{};
-        };
-        for (int i = 0; i <= 3; ++i) {
-            glm::vec3 cur = startPosition * (float)(1 - (i)/(3.f)) + endPosition * ((float)(i)/3.f);
-            //shoot rays radially about this current position and intersect them with the triangle mesh.
-            std::vector<RayShapePair> rays{};
-            for (int i = 0; i < 100; ++i) {
-                float theta = (2.0f * glm::pi<float>() * i) / 100; // Angle in radians
-                glm::vec3 rayDirection = cos(theta) * u + sin(theta) * v;
-                Ray ray; ray.origin = cur; ray.direction = rayDirection;
-                auto line = CubeBuilder().build();
-                line->setModelingTransform(vector::scaleGeometryBetweenTwoPointsTransformation(ray.origin + ray.direction * 1.f, ray.origin));
-                renderer.addMesh(line);
-                RayShapePair pair; pair.ray = ray; pair.shape = line;
-                rays.push_back(pair); // Ray direction from the origin
-            }
-            std::vector<Triangle> candidates;
-            for (auto ray : rays) {
-                std::vector<glm::vec3> triangles = theShape.lock()->getPositions();
-                bool bAddedRay = false;
-                for (int i = 0; i < triangles.size(); i+=3) {
-                    Triangle triangle(triangles[i], triangles[i+1], triangles[i+2]);
-                    auto result = vector::rayTriangleIntersection(ray.ray, triangle);
-                    for (auto res : result) {
-                        if (std::find_if(candidates.begin(), candidates.end(), [&triangle](const Triangle& e){
-                            return triangle.a == e.a && triangle.b == e.b && triangle.c == e.c;
-                        }) == candidates.end()) {
-                            candidates.push_back(triangle);
-                            if (glm::length(res - ray.ray.origin) > 2.f) {
-                                continue;
-                            }
-                            ray.shape->setModelingTransform(vector::scaleGeometryBetweenTwoPointsTransformation(res, ray.ray.origin));
-                            ray.shape->setColour(glm::vec3(0.0f,1.0f,0.0f));
-                            bAddedRay = true;
-                        }
+        if (glm::length(endPosition - startPosition) < 1e-4f) {
+            return;
+        }
+        //off the render thread, each station's walls show up as soon as they're found
+        crossSectionJobs.push_back(CrossSectionJob::extract(theShape.lock()->getMesh(), startPosition, endPosition, [&renderer](CrossSection&& section) {
+            renderer.runOnRenderThread([&renderer, section = std::move(section)] {
+                for (size_t i = 0; i < section.rays.size(); ++i) {
+                    const RayHit& hit = section.hits[i];
+                    if (hit.primitive < 0 || glm::length(hit.position - section.rays[i].origin) > 2.f) {
+                        continue;
                     }
+                    auto line = CubeBuilder().build();
+                    line->setModelingTransform(vector::scaleGeometryBetweenTwoPointsTransformation(hit.position, section.rays[i].origin));
+                    line->setColour(glm::vec3(0.0f,1.0f,0.0f));
+                    renderer.addMesh(line);
                 }
-                if (!bAddedRay) {
-                    renderer.removeShape(ray.shape);
+                if (section.triangles.empty()) {
+                    return;
                 }
-            }
-            std::shared_ptr<Shape> meshoon = std::shared_ptr<ArbitraryShape>(new ArbitraryShape(candidates));
-            meshoon->setColour(glm::vec3(0.0f,1.0f,0.0f));
-            renderer.addMesh(meshoon);
-        }
+                std::shared_ptr<Shape> meshoon = std::shared_ptr<ArbitraryShape>(new ArbitraryShape(section.triangles));
+                meshoon->setColour(glm::vec3(0.0f,1.0f,0.0f));
+                renderer.addMesh(meshoon);
+            });
+        }));
     });
     renderer.addMesh(shape);
     renderer.buildandrender(window, &camera, &theScene);
+    //the jobs post back to the renderer, so it has to outlive them
+    for (auto& job : crossSectionJobs) {
+        job.wait();
+    }
 }
 
 void window_size_callback(GLFWwindow* window, int width, int height) {
@@ -2689,9 +2707,7 @@ void textViewer(GLFWwindow* window) {
     Renderer renderer(&theScene,&glyphProgram);
     TTFont font = interpret();
     auto manager = FontLoader::loadFont(font, {});
-    while (!manager->bReady) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-    }
+    manager->waitUntilReady();
     std::ifstream file("/Users/lawrenceberardelli/Documents/writing/all_strange.txt", std::ios::binary);
     if (!file) {
             std::cerr << "Failed to open file\n";
@@ -2716,6 +2732,234 @@ void textViewer(GLFWwindow* window) {
     renderer.buildandrender(window, &camera, &theScene);
 }
 
+/*
+ No window needed. Drops n unit boxes at a fixed density (about 8 units of volume each, roughly what the spawner
+ produces once things pile up), jiggles them a little every step like the particle loop would, and times each
+ broadphase. Brute force is skipped at 100k, that's five billion tests a step.
+ */
+void broadphaseBenchmark() {
+    std::mt19937 generator(1234);
+    const int nSteps = 10;
+    for (int n : {1000, 10000, 100000}) {
+        float side = std::cbrt((float)n * 8.0f);
+        std::uniform_real_distribution<float> position(0.0f, side);
+        std::uniform_real_distribution<float> jiggle(-0.05f, 0.05f);
+        std::vector<AABB> initialBoxes(n);
+        for (auto& box : initialBoxes) {
+            glm::vec3 min(position(generator), position(generator), position(generator));
+            box = AABB(min, min + glm::vec3(1.0f));
+        }
+        std::vector<std::unique_ptr<Broadphase>> broadphases{};
+        if (n <= 10000) {
+            broadphases.push_back(std::make_unique<BruteForceBroadphase>());
+        }
+        broadphases.push_back(std::make_unique<SpatialHashBroadphase>());
+        broadphases.push_back(std::make_unique<SweepAndPruneBroadphase>());
+        std::cout << n << " particles" << std::endl;
+        for (auto& broadphase : broadphases) {
+            std::vector<AABB> boxes = initialBoxes;
+            std::vector<std::pair<int, int>> pairs{};
+            std::mt19937 stepGenerator(42);
+            double totalTime = 0.0;
+            size_t pairsTested = 0;
+            size_t candidatePairs = 0;
+            for (int step = 0; step < nSteps; ++step) {
+                for (auto& box : boxes) {
+                    glm::vec3 delta(jiggle(stepGenerator), jiggle(stepGenerator), jiggle(stepGenerator));
+                    box.min += delta;
+                    box.max += delta;
+                }
+                auto start = std::chrono::high_resolution_clock::now();
+                broadphase->computePairs(boxes, pairs);
+                auto end = std::chrono::high_resolution_clock::now();
+                totalTime += std::chrono::duration<double, std::milli>(end - start).count();
+                pairsTested += broadphase->getStats().pairsTested;
+                candidatePairs += broadphase->getStats().candidatePairs;
+            }
+            std::cout << "  " << std::setw(16) << std::left << broadphase->name()
+                      << " pairs tested/step: " << std::setw(12) << pairsTested / nSteps
+                      << " overlapping/step: " << std::setw(8) << candidatePairs / nSteps
+                      << " time/step: " << totalTime / nSteps << " ms" << std::endl;
+        }
+    }
+}
+
+/*
+ Steps a million particles under gravity and drag for a second of simulated time and prints the cost per step.
+ Nothing is drawn, this is just the integrator. Has to stay well under ~16ms to keep up at 60Hz.
+ */
+void particleSystemBenchmark() {
+    const int nParticles = 1000000;
+    const int nSteps = 60;
+    ParticleSystem system(CubeBuilder().build());
+    system.setGravity();
+    system.setDrag(0.1f, 0.01f);
+    system.reserve(nParticles);
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    for (int i = 0; i < nParticles; ++i) {
+        system.addParticle(glm::vec3(position(generator), position(generator), position(generator)), 1.0f, glm::vec3(0.0f, 20.0f, 0.0f));
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int step = 0; step < nSteps; ++step) {
+        system.step(1.0f / 60.0f);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double totalTime = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << nParticles << " particles, " << simd::width << " wide: " << totalTime / nSteps << " ms/step" << std::endl;
+}
+
+/*
+ One fan of rays against a soup of triangles, the way the rigging module shoots them, through the old
+ allocating test, the scalar one, the wide one (a ray against simd::width triangles) and the packet one.
+ */
+void rayTriangleBenchmark() {
+    const int nTriangles = 100000;
+    const int nRays = 100;
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+    std::vector<glm::vec3> triangles{};
+    triangles.reserve(3 * nTriangles);
+    for (int i = 0; i < nTriangles; ++i) {
+        glm::vec3 centre(position(generator), position(generator), position(generator));
+        for (int j = 0; j < 3; ++j) {
+            triangles.push_back(centre + glm::vec3(offset(generator), offset(generator), offset(generator)));
+        }
+    }
+    PackedTriangles packedTriangles(triangles);
+    std::vector<Ray> rays{};
+    for (int i = 0; i < nRays; ++i) {
+        float theta = (2.0f * glm::pi<float>() * i) / nRays;
+        rays.push_back(Ray{glm::vec3(0.0f), glm::vec3(cos(theta), sin(theta), 0.0f)});
+    }
+    auto time = [](auto&& body) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+    int nOld = 0, nScalar = 0, nWide = 0, nPacket = 0;
+    double oldTime = time([&] {
+        for (const Ray& ray : rays) {
+            float nearest = std::numeric_limits<float>::infinity();
+            for (int i = 0; i < nTriangles; ++i) {
+                for (const glm::vec3& hit : vector::rayTriangleIntersection(ray, Triangle(triangles[3*i], triangles[3*i + 1], triangles[3*i + 2]))) {
+                    nearest = std::min(nearest, glm::length(hit - ray.origin));
+                }
+            }
+            nOld += nearest != std::numeric_limits<float>::infinity();
+        }
+    });
+    double scalarTime = time([&] {
+        for (const Ray& ray : rays) {
+            float tMax = std::numeric_limits<float>::infinity();
+            bool bHit = false;
+            for (int i = 0; i < nTriangles; ++i) {
+                float t;
+                if (vector::rayTriangleIntersection(ray, triangles[3*i], triangles[3*i + 1], triangles[3*i + 2], tMax, t)) {
+                    tMax = t;
+                    bHit = true;
+                }
+            }
+            nScalar += bHit;
+        }
+    });
+    double wideTime = time([&] {
+        for (const Ray& ray : rays) {
+            RayHit hit{};
+            nWide += vector::rayTriangleIntersection(ray, packedTriangles, std::numeric_limits<float>::infinity(), hit);
+        }
+    });
+    double packetTime = time([&] {
+        for (int first = 0; first < nRays; first += RayPacket::SIZE) {
+            RayPacket packet;
+            for (int i = first; i < nRays && packet.add(rays[i]); ++i) {}
+            std::array<RayHit, RayPacket::SIZE> hits;
+            nPacket += vector::rayPacketIntersection(packet, packedTriangles, std::numeric_limits<float>::infinity(), hits);
+        }
+    });
+    std::cout << nRays << " rays x " << nTriangles << " triangles, " << simd::width << " wide" << std::endl;
+    std::cout << "allocating: " << oldTime << " ms (" << nOld << " hit)" << std::endl;
+    std::cout << "scalar: " << scalarTime << " ms (" << nScalar << " hit)" << std::endl;
+    std::cout << "wide: " << wideTime << " ms (" << nWide << " hit)" << std::endl;
+    std::cout << "packet: " << packetTime << " ms (" << nPacket << " hit)" << std::endl;
+}
+
+/*
+ Every simple glyph of the font we ship (interpret()), its 64x64 SDF through the original texel-by-edge loop and
+ through GlyphSDF::compute. The inside/outside has to match exactly, the distances to within rounding.
+ */
+void glyphSDFBenchmark() {
+    TTFont font = interpret();
+    std::vector<std::shared_ptr<SimpleGlyph>> glyphs{};
+    for (int i = 0; i < font.getNGlyphs(); ++i) {
+        auto glyph = std::dynamic_pointer_cast<SimpleGlyph>(FontLoader::compileGlyph(font, i));
+        if (glyph && !glyph->getEdges().empty()) {
+            glyphs.push_back(glyph);
+        }
+    }
+    std::vector<float> reference(glyphs.size() * GlyphSDF::SIZE * GlyphSDF::SIZE);
+    std::vector<float> fast(reference.size());
+    auto time = [](auto&& body) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+    double referenceTime = time([&] {
+        for (size_t i = 0; i < glyphs.size(); ++i) {
+            GlyphSDF::computeReference(glyphs[i]->getEdges(), &reference[i * GlyphSDF::SIZE * GlyphSDF::SIZE]);
+        }
+    });
+    double fastTime = time([&] {
+        for (size_t i = 0; i < glyphs.size(); ++i) {
+            GlyphSDF::compute(glyphs[i]->getEdges(), &fast[i * GlyphSDF::SIZE * GlyphSDF::SIZE]);
+        }
+    });
+    size_t nSignsDiffer = 0;
+    float maxError = 0.0f;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        nSignsDiffer += std::signbit(reference[i]) != std::signbit(fast[i]);
+        maxError = std::max(maxError, std::abs(reference[i] - fast[i]));
+    }
+    std::cout << glyphs.size() << " glyphs, " << simd::width << " wide" << std::endl;
+    std::cout << "reference: " << referenceTime << " ms" << std::endl;
+    std::cout << "kernel: " << fastTime << " ms" << std::endl;
+    std::cout << "signs differing: " << nSignsDiffer << ", largest distance difference: " << maxError << " em units" << std::endl;
+    //against the curves themselves, what the 50 segments a curve cost in quality and what skipping them saves
+    std::vector<float> exact(reference.size());
+    double quadraticTime = time([&] {
+        for (size_t i = 0; i < glyphs.size(); ++i) {
+            GlyphSDF::computeQuadratic(glyphs[i]->getQuadratics(), &exact[i * GlyphSDF::SIZE * GlyphSDF::SIZE]);
+        }
+    });
+    size_t nSignsDifferExact = 0;
+    float maxFlatteningError = 0.0f;
+    for (size_t i = 0; i < exact.size(); ++i) {
+        nSignsDifferExact += std::signbit(exact[i]) != std::signbit(fast[i]);
+        maxFlatteningError = std::max(maxFlatteningError, std::abs(exact[i] - fast[i]));
+    }
+    double flattenedLoad = time([&] {
+        for (int i = 0; i < font.getNGlyphs(); ++i) {
+            FontLoader::compileGlyph(font, i, GlyphSDF::Mode::FLATTENED);
+        }
+    });
+    double quadraticLoad = time([&] {
+        for (int i = 0; i < font.getNGlyphs(); ++i) {
+            FontLoader::compileGlyph(font, i, GlyphSDF::Mode::QUADRATIC);
+        }
+    });
+    std::cout << "quadratic kernel: " << quadraticTime << " ms" << std::endl;
+    std::cout << "signs differing from flattened: " << nSignsDifferExact << ", largest distance difference: " << maxFlatteningError << " em units" << std::endl;
+    double msdfLoad = time([&] {
+        for (int i = 0; i < font.getNGlyphs(); ++i) {
+            FontLoader::compileGlyph(font, i, GlyphSDF::Mode::MSDF, GlyphSDF::MSDF_SIZE);
+        }
+    });
+    std::cout << "whole font, flattened: " << flattenedLoad << " ms, quadratic: " << quadraticLoad << " ms, msdf: " << msdfLoad << " ms" << std::endl;
+    std::cout << "bytes a glyph, single channel: " << GlyphSDF::SIZE * GlyphSDF::SIZE * sizeof(float) << ", msdf: " << GlyphSDF::MSDF_SIZE * GlyphSDF::MSDF_SIZE * 3 << std::endl;
+}
 
 /*
  TODO: Using MVC to define multiple viewing rectangles. Tinker with glViewport and google around to see examples.
@@ -2750,6 +2994,10 @@ int main(int argc, const char * argv[]) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glViewport(0, 0, ScreenHeight::screen_width, ScreenHeight::screen_height);
     renderFontEngine(window);
+    //broadphaseBenchmark();
+    //particleSystemBenchmark();
+    //rayTriangleBenchmark();
+    //glyphSDFBenchmark();
 
     glfwTerminate();
     return 0;
@@ -16,7 +16,7 @@
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 
-#include "texture.h"
+#include "assetstreamer.h"
 
 class sierpinski {
     
@@ -113,8 +113,11 @@ public:
         projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
         
-        unsigned int texture = texture::generateTexture("/Users/lawrenceberardelli/Documents/coding/c++/learnopengl/LearnOpenGLProject1/LearnOpenGLProject1/container.jpg");
+        //no Renderer here, so it has its own streamer to pump
+        AssetStreamer streamer{};
+        unsigned int texture = streamer.loadTexture("/Users/lawrenceberardelli/Documents/coding/c++/learnopengl/LearnOpenGLProject1/LearnOpenGLProject1/container.jpg");
         while (!glfwWindowShouldClose(window)) {
+            streamer.pump();
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glEnable(GL_DEPTH_TEST);
@@ -16,6 +16,7 @@
 #include <sstream>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <gtx/string_cast.hpp>
+#include <gtx/quaternion.hpp>
 #include <string>
 
 #include "shape.h"
@@ -23,22 +24,8 @@
 #include "vector.h"
 #include "axies.h"
 #include "square.h"
-
-class SceneListNode {
-public:
-    std::shared_ptr<Shape> data;
-    SceneListNode* next = 0;
-    
-    SceneListNode(SceneListNode& that) {
-        data = that.data->clone();
-        if (that.next) {
-            next = new SceneListNode(*that.next);
-        }
-    }
-    
-    SceneListNode() = default;
-    
-};
+#include "simulationclock.h"
+#include "transformhierarchy.h"
 
 class Scene;
 
@@ -47,62 +34,106 @@ class Scene;
 class SceneList : public Shape {
     friend Scene;
 private:
-    SceneListNode* head = 0;
-    void dtor_helper_rec(SceneListNode* tmp) {
-        if (tmp->next) {
-            dtor_helper_rec(tmp->next);
+    /*
+     Node 0 of the hierarchy is the list itself, its local transform is the list's modelling transform. Every shape
+     under it is a node after it with a transform relative to its parent, and a list added to this one is folded in
+     (its nodes are moved over under a node for it) so a sprite made of lists is still one flat array and moving it
+     is one pass over its range. The shapes only get their world transform pushed when it actually changed.
+     */
+    struct Node {
+        std::shared_ptr<Shape> shape;
+        //a list folded into this one, there for its transform (and its callbacks) but it has nothing to draw
+        bool bGroup = false;
+        //outside the frustum as of the last cullParts, for a group that's everything under it
+        bool bCulled = false;
+    };
+    TransformHierarchy hierarchy{};
+    std::vector<Node> nodes{};
+    //scratch for cullParts, per node box of everything under it
+    std::vector<AABB> bounds{};
+    std::vector<bool> bHasBounds{};
+    
+    void initRoot() {
+        hierarchy.add(-1, modellingTransform);
+        nodes.push_back(Node());
+    }
+    
+    void updateWorldTransforms() {
+        hierarchy.update([this](int node) {
+            Node& cur = nodes[node];
+            if (!cur.shape) {
+                return;
+            }
+            if (cur.bGroup) {
+                cur.shape->Shape::setModelingTransform(glm::mat4(hierarchy.getWorld(node)));
+            }
+            else {
+                cur.shape->setModelingTransform(glm::mat4(hierarchy.getWorld(node)));
+            }
+        });
+    }
+    
+    int insertNode(int parent, const glm::mat4& local, Node&& node) {
+        int index = hierarchy.add(parent, local);
+        nodes.insert(nodes.begin() + index, std::move(node));
+        return index;
+    }
+    
+    //the shapes that draw, skipping the group nodes
+    template <typename Visit>
+    void forEachLeaf(Visit&& visit) {
+        updateWorldTransforms();
+        for (size_t i = 1; i < nodes.size(); ++i) {
+            if (!nodes[i].bGroup) {
+                visit(*nodes[i].shape);
+            }
         }
-        delete tmp;
     }
     
 public:
     
-    SceneList(const SceneList& that) : Shape(that) {
-        if (that.head) {
-            this->head = new SceneListNode(*that.head);
+    SceneList(const SceneList& that) : Shape(that), hierarchy(that.hierarchy), nodes(that.nodes) {
+        for (size_t i = 1; i < nodes.size(); ++i) {
+            nodes[i].shape = nodes[i].shape->clone();
         }
     }
     
     void setColour(glm::vec3 colour) override {
-        SceneListNode* cur = head;
-        while (cur) {
-            cur->data->setColour(colour);
-            cur = cur->next;
-        }
+        forEachLeaf([&](Shape& shape) {
+            shape.setColour(colour);
+        });
     }
     
     explicit SceneList(std::vector<std::shared_ptr<Shape>>&& source) {
-        for (auto&& src : source) {
-            addShape(std::move(src));
-        }
+        initRoot();
+        addShapes(std::move(source));
     }
     
     virtual void translate(glm::mat4& translation) override {
         Shape::translate(translation);
-        SceneListNode* cur = head;
-        while (cur) {
-            cur->data->translate(translation);
-            cur = cur->next;
-        }
+        hierarchy.setLocal(0, modellingTransform);
     }
     
+    /*
+     Keeps the shape where it is: its local transform is taken relative to the list as it stands. A SceneList is
+     folded in and left empty, so hold on to the outer list rather than the one added.
+     */
     void addShape(std::shared_ptr<Shape> shape) {
-        if (!head) {
-            SceneListNode* node = new SceneListNode();
-            node->data = std::move(shape);
-            node->next = 0;
-            head = node;
+        glm::mat4 toList = glm::inverse(modellingTransform);
+        std::shared_ptr<SceneList> list = std::dynamic_pointer_cast<SceneList>(shape);
+        if (!list) {
+            insertNode(0, toList * shape->getModellingTransform(), Node{std::move(shape)});
+            return;
         }
-        else {
-            SceneListNode* tmp = head;
-            while (tmp->next) {
-                tmp = tmp->next;
-            }
-            SceneListNode* node = new SceneListNode();
-            node->data = std::move(shape);
-            node->next = 0;
-            tmp->next = node;
+        int group = insertNode(0, toList * list->modellingTransform, Node{shape, true});
+        //its nodes are already parents first, so each lands at the end of its (already moved) parent's range
+        std::vector<int> moved(list->nodes.size(), group);
+        for (int i = 1; i < (int)list->nodes.size(); ++i) {
+            moved[i] = insertNode(moved[list->hierarchy.getParent(i)], list->hierarchy.getLocal(i), std::move(list->nodes[i]));
         }
+        list->nodes.clear();
+        list->hierarchy.clear();
+        list->initRoot();
     }
     
     void addShapes(std::vector<std::shared_ptr<Shape>>&& shapes) {
@@ -111,37 +142,94 @@ public:
         }
     }
     
-    virtual void render(ShaderProgram shaderProgram) override {
-        SceneListNode* tmp = head;
+    virtual void render(ShaderProgram& shaderProgram) override {
         float angle = glm::radians(1.0f);
         addRotationTransform(glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)));
-        while (tmp) {
-            tmp->data->render(shaderProgram);
-            tmp = tmp->next;
+        updateWorldTransforms();
+        for (int i = 1; i < (int)nodes.size();) {
+            if (nodes[i].bCulled) {
+                i = hierarchy.getSubtreeEnd(i);
+                continue;
+            }
+            if (!nodes[i].bGroup) {
+                nodes[i].shape->render(shaderProgram);
+            }
+            ++i;
         }
         Shape::renderAABB(getAABB(), shaderProgram);
     }
     
-    virtual  void addRotationTransform(glm::mat4&& transform) override {
-        modellingTransform = modellingTransform * transform;
-        SceneListNode* tmp = head;
-        while (tmp) {
-            tmp->data->addRotationTransform(std::move(transform));
-            tmp = tmp->next;
+    /*
+     Boxes for the groups are built bottom up (children come after their parent, so backwards), then the tree is
+     walked top down and a group that's wholly in or out settles its whole range at once.
+     */
+    virtual int cullParts(const Frustum& frustum, Containment containment) override {
+        updateWorldTransforms();
+        int n = (int)nodes.size();
+        bounds.assign(n, AABB::empty());
+        bHasBounds.assign(n, false);
+        if (containment != Containment::INSIDE) {
+            for (int i = n - 1; i > 0; --i) {
+                if (!nodes[i].bGroup) {
+                    std::vector<glm::vec3> aabb = nodes[i].shape->getAABB();
+                    //no box to go by, leave it to its own parts
+                    if (aabb.size() > 1) {
+                        bounds[i] = AABB(aabb);
+                        bHasBounds[i] = true;
+                    }
+                }
+                int parent = hierarchy.getParent(i);
+                if (bHasBounds[i] && parent > 0) {
+                    bounds[parent].grow(bounds[i]);
+                    bHasBounds[parent] = true;
+                }
+            }
         }
+        int nCulled = 0;
+        for (int i = 1; i < n;) {
+            Containment part = containment;
+            if (containment != Containment::INSIDE) {
+                part = bHasBounds[i] ? frustum.classify(bounds[i]) : Containment::PARTIAL;
+            }
+            if (part == Containment::PARTIAL) {
+                nodes[i].bCulled = false;
+                if (!nodes[i].bGroup) {
+                    nCulled += nodes[i].shape->cullParts(frustum, part);
+                }
+                ++i;
+                continue;
+            }
+            int end = hierarchy.getSubtreeEnd(i);
+            nodes[i].bCulled = part == Containment::OUTSIDE;
+            for (int j = i; j < end; ++j) {
+                if (j > i) {
+                    nodes[j].bCulled = false;
+                }
+                if (!nodes[j].bGroup) {
+                    nCulled += nodes[i].bCulled ? 1 : nodes[j].shape->cullParts(frustum, part);
+                }
+            }
+            i = end;
+        }
+        return nCulled;
+    }
+    
+    //without the spin, or the list would turn twice as fast with the picker on
+    virtual void renderID(ShaderProgram& shaderProgram) override {
+        forEachLeaf([&](Shape& shape) {
+            shape.renderID(shaderProgram);
+        });
     }
     
+    //addRotationTransform and updateModellingTransform come through here too
     virtual void setModelingTransform(glm::mat4&& transform) override {
-        SceneListNode* tmp = head;
         Shape::setModelingTransform(glm::mat4(transform));
-        while (tmp) {
-            tmp->data->setModelingTransform(glm::mat4(transform));
-            tmp = tmp->next;
-        }
+        hierarchy.setLocal(0, modellingTransform);
     }
     
-    virtual void updateModellingTransform(glm::mat4&& transform) override {
-        Shape::updateModellingTransform(glm::mat4(transform));
+    virtual void setModelingTransform(glm::mat4& transform) override {
+        Shape::setModelingTransform(transform);
+        hierarchy.setLocal(0, modellingTransform);
     }
     
     void setPosition(glm::vec3 position) {
@@ -156,33 +244,37 @@ public:
     
     virtual std::vector<glm::vec3> getPositions() override {
         std::vector<glm::vec3> positions{};
-        SceneListNode* cur = head;
-        while (cur) {
-            for (auto pos : cur->data->getPositions()) {
+        forEachLeaf([&](Shape& shape) {
+            for (auto pos : shape.getPositions()) {
                 positions.push_back(pos);
             }
-            cur = cur->next;
-        }
+        });
         return positions;
     }
     
+    virtual bool intersectRay(const Ray& ray, RayHit& hit) override {
+        bool bHit = false;
+        forEachLeaf([&](Shape& shape) {
+            bHit = shape.intersectRay(ray, hit) || bHit;
+        });
+        return bHit;
+    }
+    
+    //compose the children's (cached) boxes rather than gathering every vertex in the subtree
     virtual std::vector<glm::vec3> getAABB() override {
-        if (!head) {
+        std::vector<glm::vec3> aabb{};
+        forEachLeaf([&](Shape& shape) {
+            aabb = Shape::mergeAABB(aabb, shape.getAABB());
+        });
+        if (aabb.size() < 2) {
             return std::vector<glm::vec3>({glm::vec3(0.0,0.0f,0.0)});
         }
-        std::vector<glm::vec3> allPositions = getPositions();
-        return Shape::computeAABB(allPositions);
+        return aabb;
     }
     
-    virtual ~SceneList() {
-        if (head == 0) {
-            return;
-        }
-        SceneListNode* tmp = head;
-        dtor_helper_rec(tmp);
+    SceneList() {
+        initRoot();
     }
-    
-    SceneList() {}
 };
 
 
@@ -323,10 +415,7 @@ public:
         }
     }
     
-    void render(ShaderProgram program, glm::mat4 accumulatedTranslation, int frameNumber) {
-        if (name.find("End Site") != std::string::npos) {
-            return;
-        }
+    glm::mat4 rotationAt(int frameNumber) {
         glm::mat4 rot{};
         if (rotationOrder == "xyz") {
             glm::mat4 zrot = glm::rotate(glm::mat4(1.0f), glm::radians(rotations[frameNumber].z), glm::vec3(0.0f, 0.0f, 1.0f));
@@ -364,14 +453,35 @@ public:
             glm::mat4 zrot = glm::rotate(glm::mat4(1.0f), glm::radians(rotations[frameNumber].x), glm::vec3(0.0f, 0.0f, 1.0f));
             rot = zrot * yrot * xrot;
         }
-        data->setModelingTransform(accumulatedTranslation * glm::translate(glm::mat4(1.0f), localOffsets[frameNumber]) * rot * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f/5.f)));
+        return rot;
+    }
+    
+    /*
+     Pose blended between two frames: offsets lerped, rotations slerped (lerping the euler angles would take the
+     long way round whenever a channel wraps past 180).
+     */
+    glm::mat4 localTransformAt(int frameNumber, int nextFrameNumber, float alpha) {
+        if (alpha <= 0.0f || nextFrameNumber == frameNumber) {
+            return glm::translate(glm::mat4(1.0f), localOffsets[frameNumber]) * rotationAt(frameNumber);
+        }
+        glm::vec3 offset = glm::mix(localOffsets[frameNumber], localOffsets[nextFrameNumber], alpha);
+        glm::quat rotation = glm::slerp(glm::quat_cast(rotationAt(frameNumber)), glm::quat_cast(rotationAt(nextFrameNumber)), alpha);
+        return glm::translate(glm::mat4(1.0f), offset) * glm::mat4_cast(rotation);
+    }
+    
+    void render(ShaderProgram& program, glm::mat4 accumulatedTranslation, int frameNumber, int nextFrameNumber = 0, float alpha = 0.0f) {
+        if (name.find("End Site") != std::string::npos) {
+            return;
+        }
+        glm::mat4 local = localTransformAt(frameNumber, nextFrameNumber, alpha);
+        data->setModelingTransform(accumulatedTranslation * local * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f/5.f)));
         if (parent) {
             interGeometry->setModelingTransform(vector::scaleGeometryBetweenTwoPointsTransformation(data->getPosition(), parent->data->getPosition()));
             interGeometry->render(program);
         }
         data->render(program);
         for (auto child : children) {
-            child->render(program, accumulatedTranslation * glm::translate(glm::mat4(1.0f), localOffsets[frameNumber]) * rot, frameNumber);
+            child->render(program, accumulatedTranslation * local, frameNumber, nextFrameNumber, alpha);
         }
     }
 };
@@ -379,15 +489,16 @@ public:
 class SceneGraph : public Shape {
 private:
     SceneGraphNode* head = 0;
-    int fps;
+    float fps = 30.0f;
     int nFrames;
     std::vector<float> frameData{};
     int nChannels{};
     int currentFrame{};
+    const SimulationClock* clock = nullptr;
     
 private:
     
-    SceneGraph(SceneGraph& that) : fps(that.fps), nFrames(that.nFrames), nChannels(that.nChannels), currentFrame(that.currentFrame) {
+    SceneGraph(SceneGraph& that) : fps(that.fps), nFrames(that.nFrames), nChannels(that.nChannels), currentFrame(that.currentFrame), clock(that.clock) {
         frameData = that.frameData;
     }
     
@@ -471,7 +582,7 @@ public:
                         else if (line.find("Frame") != std::string::npos) {
                             std::string spf = line.substr(12, line.length());
                             float spff = std::stof(spf);
-                            fps = (int)(1.0f/spff);
+                            fps = 1.0f/spff;
                         }
                         else {
                             std::string data{};
@@ -507,15 +618,40 @@ public:
         dtor_rec_helper(head);
     }
     
-    virtual void render(ShaderProgram program) override {
-        ++currentFrame;
+    /*
+     With a clock the motion plays back at the file's frame rate, sampled at the clock's render time and blended
+     between the two frames either side of it. Without one it falls back to a frame per render call.
+     */
+    void setClock(const SimulationClock* clock) {
+        this->clock = clock;
+    }
+    
+    virtual void render(ShaderProgram& program) override {
         glm::mat4 defaultTranslation = glm::translate(glm::mat4(1.0f), glm::vec3(0.f,0.f,0.f));
+        if (clock && nFrames > 0) {
+            //frame data starts at 1, index 0 is the rest pose from the hierarchy
+            double framePosition = std::fmod(clock->getRenderTime() * fps, (double)nFrames);
+            int frame = (int)framePosition;
+            float alpha = (float)(framePosition - frame);
+            head->render(program, defaultTranslation, frame + 1, (frame + 1) % nFrames + 1, alpha);
+            return;
+        }
+        ++currentFrame;
         head->render(program, defaultTranslation, currentFrame);
         if (currentFrame % (nFrames) == 0) {
             currentFrame = 1;
         }
     }
     
+    //same pose as render, but without a clock we mustn't step the frame a second time
+    virtual void renderID(ShaderProgram& program) override {
+        if (clock && nFrames > 0) {
+            render(program);
+            return;
+        }
+        head->render(program, glm::mat4(1.0f), currentFrame);
+    }
+    
     virtual std::shared_ptr<Shape> clone() override {
         auto retval = std::shared_ptr<SceneGraph>(new SceneGraph(*this));
         retval->referenceToThis = retval;
@@ -12,15 +12,103 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <glm.hpp>
 #include <gtc/type_ptr.hpp>
 
+/*
+ A resolved uniform location tagged with the type it holds, so hot uniforms can be set without a
+ string lookup and without accidentally sending a vec3 to a mat4.
+ */
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+};
+
+/*
+ View, projection, light and eye are the same for every program in a frame, so they live in one std140
+ uniform block (FrameData in the shaders) that the renderer updates once per frame. Layout has to match
+ the glsl: vec3s are padded out to 16 bytes under std140.
+ */
+class FrameDataBlock {
+private:
+    struct FrameData {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 lightColour;
+        glm::vec4 lightPosition;
+        glm::vec4 eye;
+    };
+    
+    unsigned int ubo = 0;
+    
+public:
+    static constexpr unsigned int BINDING = 0;
+    static constexpr const char* NAME = "FrameData";
+    
+    void init() {
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    
+    bool isInitialized() const {
+        return ubo != 0;
+    }
+    
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightColour, const glm::vec3& lightPosition, const glm::vec3& eye) {
+        FrameData data{view, projection, glm::vec4(lightColour, 0.f), glm::vec4(lightPosition, 1.f), glm::vec4(eye, 1.f)};
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
 class ShaderProgram {
   
 private:
     
+    std::unordered_map<std::string, GLint> uniformLocations{};
+    bool bUsesFrameData = false;
+    
+    /*
+     Called once the program links. Walks the active uniforms so that the setters never have to ask the driver,
+     and points the FrameData block (if the program has one) at the shared binding.
+     */
+    void cacheUniformLocations() {
+        uniformLocations.clear();
+        GLint nUniforms = 0;
+        glGetProgramiv(pid, GL_ACTIVE_UNIFORMS, &nUniforms);
+        char name[256];
+        for (GLint i = 0; i < nUniforms; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(pid, i, sizeof(name), &length, &size, &type, name);
+            std::string uniformName(name, length);
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+                uniformName.erase(uniformName.size() - 3);
+            }
+            //block members are active uniforms too but have no location
+            GLint location = glGetUniformLocation(pid, uniformName.c_str());
+            if (location != -1) {
+                uniformLocations[uniformName] = location;
+            }
+        }
+        GLuint blockIndex = glGetUniformBlockIndex(pid, FrameDataBlock::NAME);
+        bUsesFrameData = blockIndex != GL_INVALID_INDEX;
+        if (bUsesFrameData) {
+            glUniformBlockBinding(pid, blockIndex, FrameDataBlock::BINDING);
+        }
+        model = getUniform<glm::mat4>("model");
+        colour = getUniform<glm::vec3>("aColour");
+    }
+    
     std::string readShaderFromFile(std::string& shader) {
         std::string content;
         std::ifstream fileStream(shader, std::ios::in);
@@ -45,6 +133,10 @@ public:
     std::string vertexShaderName;
     std::string fragmentShaderName;
     
+    //hot uniforms, set by nearly every shape on every render
+    Uniform<glm::mat4> model{};
+    Uniform<glm::vec3> colour{};
+    
     ShaderProgram(std::string vertexShaderName, std::string fragmentShaderName) : vertexShaderName{vertexShaderName}, fragmentShaderName{fragmentShaderName} {}
     
     ShaderProgram(){}
@@ -106,6 +198,7 @@ public:
         glDeleteShader(fragmentShader);
 
         pid = shaderProgram;
+        cacheUniformLocations();
     }
     
     void createShaderProgram(std::string vertexPath, std::string tessControlPath,
@@ -141,6 +234,7 @@ public:
         glDeleteShader(geometryShader);
 
         pid = shaderProgram;
+        cacheUniformLocations();
     }
     
     void init() {
@@ -196,36 +290,118 @@ public:
         delete[] vshaderCString;
         delete[] fshaderCString;
         pid = shaderProgram;
+        cacheUniformLocations();
+    }
+    
+    /*
+     The program most recently handed to glUseProgram through this class. Shapes are free to bind their own
+     programs from inside render (TextBox does), so anyone skipping redundant binds has to ask here rather than
+     remember what they bound themselves.
+     */
+    static unsigned int& boundProgram() {
+        static unsigned int current = 0;
+        return current;
+    }
+    
+    bool isBound() const {
+        return boundProgram() == pid;
+    }
+    
+    /*
+     Put in front of every model matrix set through a program's model uniform, whichever program it is. The
+     renderer sets it around a single draw to show a shape somewhere other than where it is (an interpolated
+     particle) without touching the shape, and it covers a composite's children on their own programs too.
+     */
+    static glm::mat4& modelOffset() {
+        static glm::mat4 offset(1.0f);
+        return offset;
     }
     
     void bind()
     {
+        if (isBound()) {
+            return;
+        }
         glUseProgram(pid);
+        boundProgram() = pid;
     }
 
     void unbind()
     {
         glUseProgram(0);
+        boundProgram() = 0;
+    }
+    
+    bool usesFrameData() const {
+        return bUsesFrameData;
+    }
+    
+    //-1 if the program has no such active uniform, which glUniform* quietly ignores
+    GLint getUniformLocation(const std::string& name) const {
+        auto it = uniformLocations.find(name);
+        return it == uniformLocations.end() ? -1 : it->second;
+    }
+    
+    template <typename T>
+    Uniform<T> getUniform(const std::string& name) const {
+        return Uniform<T>{getUniformLocation(name)};
+    }
+    
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& data) {
+        if (uniform.location != -1 && uniform.location == model.location) {
+            glm::mat4 offsetModel = modelOffset() * data;
+            glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(offsetModel));
+            return;
+        }
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(data));
+    }
+    
+    void set(Uniform<glm::vec4> uniform, const glm::vec4& data) {
+        glUniform4fv(uniform.location, 1, glm::value_ptr(data));
+    }
+    
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& data) {
+        glUniform3fv(uniform.location, 1, glm::value_ptr(data));
+    }
+    
+    void set(Uniform<glm::vec2> uniform, const glm::vec2& data) {
+        glUniform2fv(uniform.location, 1, glm::value_ptr(data));
+    }
+    
+    void set(Uniform<float> uniform, float data) {
+        glUniform1f(uniform.location, data);
+    }
+    
+    void set(Uniform<int> uniform, int data) {
+        glUniform1i(uniform.location, data);
+    }
+    
+    void set(Uniform<unsigned int> uniform, unsigned int data) {
+        glUniform1ui(uniform.location, data);
+    }
+    
+    void setMat4(const std::string& name, const glm::mat4& data) {
+        set(getUniform<glm::mat4>(name), data);
     }
     
-    void setMat4(std::string&& name, glm::mat4& data) {
-        glUniformMatrix4fv(glGetUniformLocation(pid, name.c_str()), 1, GL_FALSE, glm::value_ptr(data));
+    void setVec4(const std::string& name, const glm::vec4& data) {
+        set(getUniform<glm::vec4>(name), data);
     }
     
-    void setVec3(std::string&& name, glm::vec3 data) {
-        glUniform3fv(glGetUniformLocation(pid, name.c_str()), 1, glm::value_ptr(data));
+    void setVec3(const std::string& name, const glm::vec3& data) {
+        set(getUniform<glm::vec3>(name), data);
     }
     
-    void setVec2(std::string&& name, glm::vec2 data) {
-        glUniform2fv(glGetUniformLocation(pid, name.c_str()), 1, glm::value_ptr(data));
+    void setVec2(const std::string& name, const glm::vec2& data) {
+        set(getUniform<glm::vec2>(name), data);
     }
     
-    void setFloat(std::string&& name, float& data) {
-        glUniform1fv(glGetUniformLocation(pid, name.c_str()), 1, &data);
+    void setFloat(const std::string& name, float data) {
+        set(getUniform<float>(name), data);
     }
     
-    void setInt(std::string&& name, int data) {
-        glUniform1i(glGetUniformLocation(pid, name.c_str()), data);
+    void setInt(const std::string& name, int data) {
+        set(getUniform<int>(name), data);
     }
 };
 
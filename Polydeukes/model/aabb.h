@@ -0,0 +1,89 @@
+//
+//  aabb.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef aabb_h
+#define aabb_h
+
+#include <glm.hpp>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+//where a box is relative to some volume (a frustum), see BVH::query
+enum class Containment {
+    OUTSIDE,
+    PARTIAL,
+    INSIDE
+};
+
+/*
+ Axis aligned box as a value, for the code that works on lots of them (broadphase, BVHs). Shape::getAABB still
+ hands back the {min, max} vector everything else uses.
+ */
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+    
+    AABB() : min(0.0f), max(0.0f) {}
+    
+    AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+    
+    //from the {min, max} vector Shape::getAABB hands back
+    explicit AABB(const std::vector<glm::vec3>& aabb) : min(aabb[0]), max(aabb.size() > 1 ? aabb[1] : aabb[0]) {}
+    
+    //inside out box, growing it by anything gives that thing's box
+    static AABB empty() {
+        return AABB(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()));
+    }
+    
+    bool overlaps(const AABB& that) const {
+        return !(max.x < that.min.x || min.x > that.max.x ||
+                 max.y < that.min.y || min.y > that.max.y ||
+                 max.z < that.min.z || min.z > that.max.z);
+    }
+    
+    void grow(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    
+    void grow(const AABB& that) {
+        min = glm::min(min, that.min);
+        max = glm::max(max, that.max);
+    }
+    
+    glm::vec3 centroid() const {
+        return (min + max) * 0.5f;
+    }
+    
+    float surfaceArea() const {
+        glm::vec3 extent = max - min;
+        if (extent.x < 0.0f) {
+            return 0.0f;
+        }
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+    
+    /*
+     Slab test against a ray given as origin and 1/direction. Returns the entry distance, clamped to 0 when the
+     origin is inside, or infinity on a miss or if the box is further than tMax.
+     */
+    float intersect(const glm::vec3& origin, const glm::vec3& inverseDirection, float tMax) const {
+        float tx1 = (min.x - origin.x) * inverseDirection.x, tx2 = (max.x - origin.x) * inverseDirection.x;
+        float tNear = std::min(tx1, tx2), tFar = std::max(tx1, tx2);
+        float ty1 = (min.y - origin.y) * inverseDirection.y, ty2 = (max.y - origin.y) * inverseDirection.y;
+        tNear = std::max(tNear, std::min(ty1, ty2)); tFar = std::min(tFar, std::max(ty1, ty2));
+        float tz1 = (min.z - origin.z) * inverseDirection.z, tz2 = (max.z - origin.z) * inverseDirection.z;
+        tNear = std::max(tNear, std::min(tz1, tz2)); tFar = std::min(tFar, std::max(tz1, tz2));
+        if (tFar >= std::max(tNear, 0.0f) && tNear < tMax) {
+            return std::max(tNear, 0.0f);
+        }
+        return std::numeric_limits<float>::infinity();
+    }
+};
+
+#endif /* aabb_h */
@@ -101,7 +101,13 @@ public:
         return retval;
     }
     
-    void render(ShaderProgram shaderProgram) override {
+    bool intersectRay(const Ray& ray, RayHit& hit) override {
+        bool bHit = head->intersectRay(ray, hit);
+        bHit = body->intersectRay(ray, hit) || bHit;
+        return tail->intersectRay(ray, hit) || bHit;
+    }
+    
+    void render(ShaderProgram& shaderProgram) override {
         head->render(shaderProgram);
         body->render(shaderProgram);
         tail->render(shaderProgram);
@@ -0,0 +1,218 @@
+//
+//  assetstreamer.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef assetstreamer_h
+#define assetstreamer_h
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <iostream>
+
+#include "texture.h"
+#include "threadpool.h"
+#include "objparser.h"
+#include "objinterpreter.h"
+
+/*
+ Loads assets without stalling the frame. The slow part (decoding an image, parsing and optimizing an OBJ,
+ building its BVH) runs on the ThreadPool, and what comes out is queued for the render thread, which is the only
+ one with the GL context. pump() runs once a frame and sends at most UPLOAD_BYTES_PER_FRAME of it to the GPU,
+ so a big scan arriving takes a few frames to go up instead of one long hitch.
+ 
+ Meshes go up in chunks with glBufferSubData. Images go through a pixel buffer so the copy into the texture
+ happens on the GPU's time, and a fence says when the pixel buffer can go. 4.1 has neither persistent mapping
+ nor a loader context worth the trouble on macOS, hence the budget rather than a second thread doing uploads.
+ 
+ Whatever's asked for is handed back straight away as a placeholder: a grey texel for a texture, a shape that
+ draws nothing until its mesh is known and then its bounding box until the buffers are resident.
+ */
+class AssetStreamer {
+public:
+    
+    static constexpr size_t UPLOAD_BYTES_PER_FRAME = 8 << 20;
+
+private:
+    //one asset on its way up: does up to budget bytes (taking off what it used), true once it's resident
+    using Upload = std::function<bool(size_t& budget)>;
+    
+    //shared with the workers, so a job finishing after the streamer's gone has somewhere to go
+    struct Incoming {
+        std::mutex mutex;
+        std::vector<Upload> uploads{};
+    };
+    
+    std::shared_ptr<Incoming> incoming = std::make_shared<Incoming>();
+    //render thread only
+    std::deque<Upload> uploading{};
+    std::atomic<int> nPending{0};
+    
+    static void post(const std::shared_ptr<Incoming>& incoming, Upload upload) {
+        std::lock_guard<std::mutex> lock(incoming->mutex);
+        incoming->uploads.push_back(std::move(upload));
+    }
+    
+    struct Image {
+        std::vector<unsigned char> pixels{};
+        int width = 0;
+        int height = 0;
+        int nChannels = 0;
+    };
+    
+    //a decoded image: into a pixel buffer and from there into the texture, then wait on the fence to free it
+    static Upload uploadImage(unsigned int texture, std::shared_ptr<Image> image) {
+        struct State {
+            unsigned int pixelBuffer = 0;
+            GLsync fence = 0;
+        };
+        auto state = std::make_shared<State>();
+        return [texture, image, state](size_t& budget) mutable {
+            if (state->fence) {
+                GLenum status = glClientWaitSync(state->fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                    return false;
+                }
+                glDeleteSync(state->fence);
+                glDeleteBuffers(1, &state->pixelBuffer);
+                return true;
+            }
+            if (budget == 0) {
+                return false;
+            }
+            GLenum format = image->nChannels == 1 ? GL_RED : image->nChannels == 2 ? GL_RG : image->nChannels == 3 ? GL_RGB : GL_RGBA;
+            glGenBuffers(1, &state->pixelBuffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, state->pixelBuffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, image->pixels.size(), image->pixels.data(), GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            //rows of an RGB image needn't be a multiple of 4 bytes
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, image->width, image->height, 0, format, GL_UNSIGNED_BYTE, (void*)0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            state->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            budget -= std::min(budget, image->pixels.size());
+            image.reset();
+            return false;
+        };
+    }
+
+public:
+    
+    AssetStreamer() = default;
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+    
+    /*
+     Render thread. The texture name is good straight away and samples as grey until the image has been decoded
+     and sent up, so it can go into a shape now. Same parameters as texture::generateTexture.
+     */
+    unsigned int loadTexture(const std::string& path) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        unsigned char grey[4] = {128, 128, 128, 255};
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        ++nPending;
+        ThreadPool::getInstance().submit([path, texture, incoming = incoming] {
+            auto image = std::make_shared<Image>();
+            unsigned char* data = stbi_load(path.c_str(), &image->width, &image->height, &image->nChannels, 0);
+            if (!data) {
+                std::cout << "Failed to load texture " << path << std::endl;
+                //keeps the grey, but still has to be counted off
+                post(incoming, [](size_t&) { return true; });
+                return;
+            }
+            image->pixels.assign(data, data + (size_t)image->width * image->height * image->nChannels);
+            stbi_image_free(data);
+            post(incoming, uploadImage(texture, std::move(image)));
+        });
+        return texture;
+    }
+    
+    /*
+     Render thread. The shape can be added to the scene, moved and given callbacks now; it's parsed (or read
+     from its cache) on the pool and draws for real once its buffers are resident. If it's dropped before then
+     the upload is skipped.
+     */
+    std::shared_ptr<Shape> loadObj(const std::string& path) {
+        auto shape = std::make_shared<ArbitraryShape>();
+        shape->initReferenceToThis();
+        std::weak_ptr<ArbitraryShape> target = shape;
+        ++nPending;
+        ThreadPool::getInstance().submit([path, target, incoming = incoming] {
+            ObjData data{};
+            if (!ObjParser::load(path, data)) {
+                std::cerr << "Failed to open the file " << path << std::endl;
+                post(incoming, [](size_t&) { return true; });
+                return;
+            }
+            auto prepared = std::make_shared<ArbitraryShape::Prepared>(ArbitraryShape::prepare(std::move(data)));
+            post(incoming, [target, prepared, bAdopted = false](size_t& budget) mutable {
+                std::shared_ptr<ArbitraryShape> shape = target.lock();
+                if (!shape) {
+                    return true;
+                }
+                if (!bAdopted) {
+                    shape->adopt(std::move(*prepared));
+                    bAdopted = true;
+                }
+                return shape->streamStep(budget);
+            });
+        });
+        return shape;
+    }
+    
+    /*
+     Render thread, once a frame. Takes whatever the workers have finished and sends up to the budget of it,
+     oldest first. Returns how many assets became resident (their VAOs change, so the renderer re-sorts).
+     */
+    int pump(size_t budget = UPLOAD_BYTES_PER_FRAME) {
+        {
+            std::lock_guard<std::mutex> lock(incoming->mutex);
+            for (auto& upload : incoming->uploads) {
+                uploading.push_back(std::move(upload));
+            }
+            incoming->uploads.clear();
+        }
+        int nResident = 0;
+        //fences are polled whatever's left of the budget, so nothing stops being walked
+        for (auto it = uploading.begin(); it != uploading.end();) {
+            if ((*it)(budget)) {
+                it = uploading.erase(it);
+                ++nResident;
+            }
+            else {
+                ++it;
+            }
+        }
+        nPending -= nResident;
+        return nResident;
+    }
+    
+    //asked for and not yet resident
+    int getPendingCount() const {
+        return nPending;
+    }
+};
+
+inline ShapeBuilder& ShapeBuilder::withTexture(AssetStreamer& streamer, const std::string& texturePath) {
+    shape->texture = streamer.loadTexture(texturePath);
+    return *this;
+}
+
+#endif /* assetstreamer_h */
@@ -43,8 +43,8 @@ public:
         return retval;
     }
     
-    void render(ShaderProgram shaderProgram) override {
-        shaderProgram.setMat4("model", modellingTransform);
+    void render(ShaderProgram& shaderProgram) override {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
         for (int i = 0; i < 3; ++i) {
             glm::vec3 colour;
             if (i == 0) {
@@ -57,7 +57,7 @@ public:
                 colour = glm::vec3(0.0f,0.0f,1.0f);
             }
             glBindVertexArray(VAO[i]);
-            shaderProgram.setVec3("aColour", colour);
+            shaderProgram.set(shaderProgram.colour, colour);
             glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT, 0);
         }
         Shape::renderAABB(getAABB(), shaderProgram);
@@ -0,0 +1,267 @@
+//
+//  broadphase.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef broadphase_h
+#define broadphase_h
+
+#include <glm.hpp>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+
+#include "aabb.h"
+#include "threadpool.h"
+
+/*
+ Collision broadphase for the particle loop. Testing every particle against every other is fine for a handful
+ of cubes but we want to drop tens of thousands of them, so the renderer hands its (cached) AABBs to one of these
+ and only runs the narrowphase on the pairs that come back.
+ 
+ Pairs are always (i, j) with i < j, indices into the boxes that were passed in, and only pairs whose boxes
+ actually overlap are reported. No self pairs. The order of the pairs is deterministic but otherwise unspecified.
+ */
+
+struct BroadphaseStats {
+    size_t pairsTested = 0;
+    size_t candidatePairs = 0;
+};
+
+class Broadphase {
+protected:
+    BroadphaseStats stats{};
+    
+    /*
+     Runs test(item, out) for every item in [0, n) on the shared pool, each chunk collecting into its own list, and
+     stitches the lists together in chunk order so the result doesn't depend on scheduling. test returns the number
+     of pairs it tested.
+     */
+    template <typename Test>
+    void parallelPairs(int n, int grain, std::vector<std::pair<int, int>>& pairs, Test&& test) {
+        std::vector<std::pair<int, std::vector<std::pair<int, int>>>> chunks{};
+        std::mutex chunksMutex;
+        std::atomic<size_t> pairsTested{0};
+        ThreadPool::getInstance().parallelFor(0, n, grain, [&](int begin, int end) {
+            std::vector<std::pair<int, int>> out{};
+            size_t tested = 0;
+            for (int item = begin; item < end; ++item) {
+                tested += test(item, out);
+            }
+            pairsTested += tested;
+            std::lock_guard<std::mutex> lock(chunksMutex);
+            chunks.emplace_back(begin, std::move(out));
+        });
+        std::sort(chunks.begin(), chunks.end(), [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+        for (auto& chunk : chunks) {
+            pairs.insert(pairs.end(), chunk.second.begin(), chunk.second.end());
+        }
+        stats.pairsTested += pairsTested;
+    }
+
+public:
+    virtual ~Broadphase() = default;
+    
+    virtual void computePairs(const std::vector<AABB>& boxes, std::vector<std::pair<int, int>>& pairs) = 0;
+    
+    virtual const char* name() const = 0;
+    
+    BroadphaseStats getStats() const {
+        return stats;
+    }
+};
+
+/*
+ What the renderer used to do, kept as the reference the other two are checked and benchmarked against.
+ */
+class BruteForceBroadphase : public Broadphase {
+public:
+    void computePairs(const std::vector<AABB>& boxes, std::vector<std::pair<int, int>>& pairs) override {
+        pairs.clear();
+        stats = BroadphaseStats{};
+        for (int i = 0; i < (int)boxes.size(); ++i) {
+            for (int j = i + 1; j < (int)boxes.size(); ++j) {
+                ++stats.pairsTested;
+                if (boxes[i].overlaps(boxes[j])) {
+                    pairs.emplace_back(i, j);
+                }
+            }
+        }
+        stats.candidatePairs = pairs.size();
+    }
+    
+    const char* name() const override {
+        return "brute force";
+    }
+};
+
+/*
+ Uniform grid, hashed so the world doesn't need bounds. Every box is registered in each cell it touches, the
+ (cell, box) entries are sorted so boxes sharing a cell end up adjacent, and each run is tested pairwise.
+ 
+ A pair of boxes can share several cells; to report it once we only test it in the cell holding the minimum
+ corner of the overlap of their two cell ranges. That saves keeping a set of seen pairs.
+ 
+ A cell size of 0 picks twice the mean box extent each step, which suits the spawner's equally sized shapes.
+ */
+class SpatialHashBroadphase : public Broadphase {
+private:
+    struct CellRange {
+        glm::ivec3 min;
+        glm::ivec3 max;
+    };
+    
+    float cellSize;
+    float currentCellSize = 1.0f;
+    std::vector<std::pair<uint64_t, int>> entries{};
+    std::vector<CellRange> ranges{};
+    std::vector<std::pair<size_t, size_t>> runs{};
+    
+    static uint64_t hashCell(int x, int y, int z) {
+        //21 bits per axis, offset so negative cells pack cleanly
+        const int64_t offset = 1 << 20;
+        const uint64_t mask = (1ull << 21) - 1;
+        return ((uint64_t)(x + offset) & mask) | (((uint64_t)(y + offset) & mask) << 21) | (((uint64_t)(z + offset) & mask) << 42);
+    }
+    
+    glm::ivec3 toCell(const glm::vec3& position) const {
+        return glm::ivec3((int)std::floor(position.x / currentCellSize), (int)std::floor(position.y / currentCellSize), (int)std::floor(position.z / currentCellSize));
+    }
+
+public:
+    
+    explicit SpatialHashBroadphase(float cellSize = 0.0f) : cellSize(cellSize) {}
+    
+    void setCellSize(float cellSize) {
+        this->cellSize = cellSize;
+    }
+    
+    void computePairs(const std::vector<AABB>& boxes, std::vector<std::pair<int, int>>& pairs) override {
+        pairs.clear();
+        stats = BroadphaseStats{};
+        if (boxes.empty()) {
+            return;
+        }
+        currentCellSize = cellSize;
+        if (currentCellSize <= 0.0f) {
+            float totalExtent = 0.0f;
+            for (auto& box : boxes) {
+                glm::vec3 extent = box.max - box.min;
+                totalExtent += std::max(extent.x, std::max(extent.y, extent.z));
+            }
+            currentCellSize = std::max(2.0f * totalExtent / (float)boxes.size(), 1e-3f);
+        }
+        entries.clear();
+        ranges.resize(boxes.size());
+        for (int i = 0; i < (int)boxes.size(); ++i) {
+            ranges[i] = CellRange{toCell(boxes[i].min), toCell(boxes[i].max)};
+            for (int x = ranges[i].min.x; x <= ranges[i].max.x; ++x) {
+                for (int y = ranges[i].min.y; y <= ranges[i].max.y; ++y) {
+                    for (int z = ranges[i].min.z; z <= ranges[i].max.z; ++z) {
+                        entries.emplace_back(hashCell(x, y, z), i);
+                    }
+                }
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        runs.clear();
+        size_t runStart = 0;
+        while (runStart < entries.size()) {
+            size_t runEnd = runStart + 1;
+            while (runEnd < entries.size() && entries[runEnd].first == entries[runStart].first) {
+                ++runEnd;
+            }
+            if (runEnd - runStart > 1) {
+                runs.emplace_back(runStart, runEnd);
+            }
+            runStart = runEnd;
+        }
+        //cells are independent, so the pair tests are split across the pool by run
+        parallelPairs((int)runs.size(), 256, pairs, [&](int run, std::vector<std::pair<int, int>>& out) {
+            size_t tested = 0;
+            for (size_t a = runs[run].first; a < runs[run].second; ++a) {
+                for (size_t b = a + 1; b < runs[run].second; ++b) {
+                    int i = entries[a].second;
+                    int j = entries[b].second;
+                    //only the cell at the low corner of the shared range reports the pair
+                    glm::ivec3 lowCorner = glm::max(ranges[i].min, ranges[j].min);
+                    if (hashCell(lowCorner.x, lowCorner.y, lowCorner.z) != entries[a].first) {
+                        continue;
+                    }
+                    ++tested;
+                    if (boxes[i].overlaps(boxes[j])) {
+                        out.emplace_back(std::min(i, j), std::max(i, j));
+                    }
+                }
+            }
+            return tested;
+        });
+        stats.candidatePairs = pairs.size();
+    }
+    
+    const char* name() const override {
+        return "spatial hash";
+    }
+};
+
+/*
+ Sort and sweep on x. The order from the previous step is kept and insertion sorted, since particles barely
+ move between frames the list is almost sorted already and this is close to linear. Degrades when everything
+ lines up on x (a stack of cubes dropped in one column), where the hash does better.
+ */
+class SweepAndPruneBroadphase : public Broadphase {
+private:
+    std::vector<int> order{};
+
+public:
+    
+    void computePairs(const std::vector<AABB>& boxes, std::vector<std::pair<int, int>>& pairs) override {
+        pairs.clear();
+        stats = BroadphaseStats{};
+        if (order.size() != boxes.size()) {
+            order.resize(boxes.size());
+            for (int i = 0; i < (int)order.size(); ++i) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+                return boxes[lhs].min.x < boxes[rhs].min.x;
+            });
+        }
+        else {
+            for (size_t i = 1; i < order.size(); ++i) {
+                int current = order[i];
+                size_t j = i;
+                while (j > 0 && boxes[order[j - 1]].min.x > boxes[current].min.x) {
+                    order[j] = order[j - 1];
+                    --j;
+                }
+                order[j] = current;
+            }
+        }
+        //the sort has to be serial but every box's sweep only reads, so those are split across the pool
+        parallelPairs((int)order.size(), 1024, pairs, [&](int a, std::vector<std::pair<int, int>>& out) {
+            size_t tested = 0;
+            const AABB& box = boxes[order[a]];
+            for (size_t b = a + 1; b < order.size() && boxes[order[b]].min.x <= box.max.x; ++b) {
+                ++tested;
+                if (box.overlaps(boxes[order[b]])) {
+                    out.emplace_back(std::min(order[a], order[b]), std::max(order[a], order[b]));
+                }
+            }
+            return tested;
+        });
+        stats.candidatePairs = pairs.size();
+    }
+    
+    const char* name() const override {
+        return "sweep and prune";
+    }
+};
+
+#endif /* broadphase_h */
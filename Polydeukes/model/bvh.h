@@ -0,0 +1,275 @@
+//
+//  bvh.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef bvh_h
+#define bvh_h
+
+#include <glm.hpp>
+#include <vector>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "aabb.h"
+#include "vector.h"
+
+/*
+ Bounding volume hierarchy over a set of boxes; what the boxes stand for is up to the caller. Meshes build one
+ over their triangles in model space (once, it's shared by every clone), and the picker builds one over the
+ scene's shapes.
+ 
+ Built top down with the surface area heuristic, binned (https://jacco.ompf2.com/2022/04/18/how-to-build-a-bvh-part-2-faster-rays/).
+ Nodes are flat in one array, children are always next to each other so a node only stores the first.
+ 
+ Ray traversal only looks for the nearest hit: the nearer child goes first and anything starting past the
+ closest hit so far is skipped. query() walks it against a volume instead (frustum culling).
+ */
+class BVH {
+private:
+    struct Node {
+        AABB bounds;
+        //leaf: first primitive in indices. interior: index of the left child, the right is the one after
+        int first = 0;
+        int count = 0;
+    };
+    
+    static constexpr int N_BINS = 12;
+    static constexpr int MAX_LEAF_SIZE = 4;
+    static constexpr int MAX_DEPTH = 60;
+    
+    std::vector<Node> nodes{};
+    std::vector<int> indices{};
+    
+    struct Bin {
+        AABB bounds = AABB::empty();
+        int count = 0;
+    };
+    
+    AABB boundsOf(const std::vector<AABB>& boxes, int first, int count) const {
+        AABB bounds = AABB::empty();
+        for (int i = first; i < first + count; ++i) {
+            bounds.grow(boxes[indices[i]]);
+        }
+        return bounds;
+    }
+    
+    //best split of a node, as axis and bin boundary, or false if splitting costs more than a leaf
+    bool findSplit(const std::vector<AABB>& boxes, const Node& node, int& bestAxis, float& bestPosition) const {
+        AABB centroidBounds = AABB::empty();
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            centroidBounds.grow(boxes[indices[i]].centroid());
+        }
+        float bestCost = std::numeric_limits<float>::max();
+        for (int axis = 0; axis < 3; ++axis) {
+            float lower = centroidBounds.min[axis];
+            float upper = centroidBounds.max[axis];
+            if (upper <= lower) {
+                continue;
+            }
+            std::array<Bin, N_BINS> bins{};
+            float scale = N_BINS / (upper - lower);
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                const AABB& box = boxes[indices[i]];
+                int bin = std::min(N_BINS - 1, (int)((box.centroid()[axis] - lower) * scale));
+                bins[bin].count++;
+                bins[bin].bounds.grow(box);
+            }
+            //sweep from both ends so each split's cost is one lookup
+            std::array<float, N_BINS - 1> leftArea{}, rightArea{};
+            std::array<int, N_BINS - 1> leftCount{}, rightCount{};
+            AABB leftBox = AABB::empty(), rightBox = AABB::empty();
+            int leftSum = 0, rightSum = 0;
+            for (int i = 0; i < N_BINS - 1; ++i) {
+                leftSum += bins[i].count;
+                leftCount[i] = leftSum;
+                leftBox.grow(bins[i].bounds);
+                leftArea[i] = leftBox.surfaceArea();
+                rightSum += bins[N_BINS - 1 - i].count;
+                rightCount[N_BINS - 2 - i] = rightSum;
+                rightBox.grow(bins[N_BINS - 1 - i].bounds);
+                rightArea[N_BINS - 2 - i] = rightBox.surfaceArea();
+            }
+            for (int i = 0; i < N_BINS - 1; ++i) {
+                if (leftCount[i] == 0 || rightCount[i] == 0) {
+                    continue;
+                }
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestPosition = lower + (i + 1) / scale;
+                }
+            }
+        }
+        float leafCost = node.count * node.bounds.surfaceArea();
+        return bestCost < leafCost || (bestCost < std::numeric_limits<float>::max() && node.count > 4 * MAX_LEAF_SIZE);
+    }
+
+public:
+    
+    BVH() = default;
+    
+    explicit BVH(const std::vector<AABB>& boxes) {
+        build(boxes);
+    }
+    
+    void build(const std::vector<AABB>& boxes) {
+        nodes.clear();
+        indices.resize(boxes.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        if (boxes.empty()) {
+            return;
+        }
+        nodes.reserve(2 * boxes.size());
+        Node root;
+        root.first = 0;
+        root.count = (int)boxes.size();
+        root.bounds = boundsOf(boxes, 0, root.count);
+        nodes.push_back(root);
+        //(node, depth)
+        std::vector<std::pair<int, int>> stack{{0, 0}};
+        while (!stack.empty()) {
+            auto [current, depth] = stack.back();
+            stack.pop_back();
+            Node node = nodes[current];
+            if (node.count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH) {
+                continue;
+            }
+            int axis = 0;
+            float position = 0.0f;
+            if (!findSplit(boxes, node, axis, position)) {
+                continue;
+            }
+            auto middle = std::partition(indices.begin() + node.first, indices.begin() + node.first + node.count, [&](int i) {
+                return boxes[i].centroid()[axis] < position;
+            });
+            int leftCount = (int)(middle - (indices.begin() + node.first));
+            if (leftCount == 0 || leftCount == node.count) {
+                continue;
+            }
+            Node left, right;
+            left.first = node.first;
+            left.count = leftCount;
+            left.bounds = boundsOf(boxes, left.first, left.count);
+            right.first = node.first + leftCount;
+            right.count = node.count - leftCount;
+            right.bounds = boundsOf(boxes, right.first, right.count);
+            int leftIndex = (int)nodes.size();
+            nodes.push_back(left);
+            nodes.push_back(right);
+            nodes[current].first = leftIndex;
+            nodes[current].count = 0;
+            stack.emplace_back(leftIndex, depth + 1);
+            stack.emplace_back(leftIndex + 1, depth + 1);
+        }
+    }
+    
+    bool empty() const {
+        return nodes.empty();
+    }
+    
+    size_t getNodeCount() const {
+        return nodes.size();
+    }
+    
+    /*
+     Walks the tree front to back calling intersectPrimitive(index, tMax) for the primitives whose boxes the ray
+     reaches before tMax. The callback should return true and shrink tMax when it finds a closer hit. Returns
+     whether anything was hit.
+     */
+    template <typename IntersectPrimitive>
+    bool intersect(const Ray& ray, float& tMax, IntersectPrimitive&& intersectPrimitive) const {
+        if (nodes.empty()) {
+            return false;
+        }
+        glm::vec3 inverseDirection = glm::vec3(1.0f) / ray.direction;
+        if (nodes[0].bounds.intersect(ray.origin, inverseDirection, tMax) == std::numeric_limits<float>::infinity()) {
+            return false;
+        }
+        bool bHit = false;
+        //(node, entry distance), the depth is capped when building so this can't overflow
+        std::array<std::pair<int, float>, MAX_DEPTH + 2> stack;
+        int stackSize = 0;
+        int current = 0;
+        while (true) {
+            const Node& node = nodes[current];
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    if (intersectPrimitive(indices[i], tMax)) {
+                        bHit = true;
+                    }
+                }
+            }
+            else {
+                int nearChild = node.first;
+                int farChild = node.first + 1;
+                float tNear = nodes[nearChild].bounds.intersect(ray.origin, inverseDirection, tMax);
+                float tFar = nodes[farChild].bounds.intersect(ray.origin, inverseDirection, tMax);
+                if (tFar < tNear) {
+                    std::swap(nearChild, farChild);
+                    std::swap(tNear, tFar);
+                }
+                if (tNear != std::numeric_limits<float>::infinity()) {
+                    if (tFar != std::numeric_limits<float>::infinity()) {
+                        stack[stackSize++] = {farChild, tFar};
+                    }
+                    current = nearChild;
+                    continue;
+                }
+            }
+            //next node on the stack that still starts before the closest hit
+            while (stackSize > 0 && stack[stackSize - 1].second >= tMax) {
+                --stackSize;
+            }
+            if (stackSize == 0) {
+                break;
+            }
+            current = stack[--stackSize].first;
+        }
+        return bHit;
+    }
+    
+    /*
+     Every primitive whose box isn't outside some volume. classify(box) says where a node's box is; nothing
+     under an OUTSIDE node is visited, and under an INSIDE one nothing more is classified. visit(index, bInside)
+     gets the primitives, with bInside when an ancestor was wholly inside.
+     */
+    template <typename Classify, typename Visit>
+    void query(Classify&& classify, Visit&& visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+        //(node, wholly inside)
+        std::array<std::pair<int, bool>, 2 * MAX_DEPTH + 2> stack;
+        int stackSize = 0;
+        stack[stackSize++] = {0, false};
+        while (stackSize > 0) {
+            auto [current, bInside] = stack[--stackSize];
+            const Node& node = nodes[current];
+            if (!bInside) {
+                Containment containment = classify(node.bounds);
+                if (containment == Containment::OUTSIDE) {
+                    continue;
+                }
+                bInside = containment == Containment::INSIDE;
+            }
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    visit(indices[i], bInside);
+                }
+            }
+            else {
+                stack[stackSize++] = {node.first + 1, bInside};
+                stack[stackSize++] = {node.first, bInside};
+            }
+        }
+    }
+
+};
+
+#endif /* bvh_h */
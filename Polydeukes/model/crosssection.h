@@ -0,0 +1,103 @@
+//
+//  crosssection.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef crosssection_h
+#define crosssection_h
+
+#include <glm.hpp>
+#include <gtc/constants.hpp>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <future>
+#include <cmath>
+
+#include "mesh.h"
+#include "vector.h"
+#include "threadpool.h"
+
+//the walls of a mesh around one point on a bone
+struct CrossSection {
+    int station = 0;
+    glm::vec3 centre = glm::vec3(0.0f);
+    //one hit per ray, in world space, primitive is -1 where the ray got out without hitting anything
+    std::vector<Ray> rays{};
+    std::vector<RayHit> hits{};
+    //every triangle some ray stopped on, once each, in world space
+    std::vector<Triangle> triangles{};
+};
+
+/*
+ Works out where a bone sits inside a mesh, for skinning: at a few stations along the bone a fan of rays goes
+ out at right angles to it and each ray stops at the first wall it hits.
+ 
+ Runs on the thread pool against a copy of the mesh (copies share the model space vertices and the triangle
+ BVH, which never change), so the render thread isn't held up and the shape can keep being drawn meanwhile.
+ Stations run in parallel and each one is handed to onSection as soon as it's done, on whichever worker
+ did it; send it back to the render thread (Renderer::runOnRenderThread) before touching the scene.
+ */
+class CrossSectionJob {
+private:
+    
+    static CrossSection computeStation(const Mesh& mesh, const glm::mat4& toModelSpace, glm::vec3 start, glm::vec3 end, int station, int nStations, int nRays) {
+        CrossSection section{};
+        section.station = station;
+        float along = nStations > 1 ? (float)station / (nStations - 1) : 0.0f;
+        section.centre = start * (1.0f - along) + end * along;
+        glm::vec3 direction = glm::normalize(end - start);
+        glm::vec3 arbitrary = (std::fabs(direction.x) > 0.1f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 u = glm::normalize(glm::cross(direction, arbitrary));
+        glm::vec3 v = glm::cross(direction, u);
+        const std::vector<glm::vec3>& triangles = mesh.getModelSpacePosition();
+        glm::mat4 toWorldSpace = mesh.getTransform();
+        auto worldSpace = [&](const glm::vec3& position) {
+            glm::vec4 tmp = toWorldSpace * glm::vec4(position.x, position.y, position.z, 1.0f);
+            return glm::vec3(tmp.x, tmp.y, tmp.z);
+        };
+        std::unordered_set<int> seen{};
+        section.rays.reserve(nRays);
+        section.hits.reserve(nRays);
+        for (int i = 0; i < nRays; ++i) {
+            float theta = (2.0f * glm::pi<float>() * i) / nRays;
+            Ray ray{section.centre, std::cos(theta) * u + std::sin(theta) * v};
+            glm::vec4 origin = toModelSpace * glm::vec4(ray.origin, 1.0f);
+            glm::vec4 rayDirection = toModelSpace * glm::vec4(ray.direction, 0.0f);
+            Ray modelSpaceRay{glm::vec3(origin.x, origin.y, origin.z), glm::vec3(rayDirection.x, rayDirection.y, rayDirection.z)};
+            RayHit hit{};
+            if (mesh.intersect(modelSpaceRay, hit)) {
+                //t is the same in both spaces since the direction wasn't renormalized
+                hit.position = ray.origin + ray.direction * hit.t;
+                if (seen.insert(hit.primitive).second) {
+                    section.triangles.emplace_back(worldSpace(triangles[3*hit.primitive]), worldSpace(triangles[3*hit.primitive + 1]), worldSpace(triangles[3*hit.primitive + 2]));
+                }
+            }
+            section.rays.push_back(ray);
+            section.hits.push_back(hit);
+        }
+        return section;
+    }
+
+public:
+    
+    /*
+     Starts the job for the bone from start to end and returns straight away. The future is ready once every
+     station has been handed over.
+     */
+    static std::future<void> extract(const Mesh& mesh, glm::vec3 start, glm::vec3 end, std::function<void(CrossSection&&)> onSection, int nStations = 4, int nRays = 100) {
+        return ThreadPool::getInstance().submit([mesh, start, end, onSection, nStations, nRays] {
+            glm::mat4 toModelSpace = glm::inverse(mesh.getTransform());
+            ThreadPool::getInstance().parallelFor(0, nStations, 1, [&](int first, int last) {
+                for (int station = first; station < last; ++station) {
+                    onSection(computeStation(mesh, toModelSpace, start, end, station, nStations, nRays));
+                }
+            });
+        });
+    }
+
+};
+
+#endif /* crosssection_h */
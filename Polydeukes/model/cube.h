@@ -51,6 +51,10 @@ public:
     
     virtual ~Cube() = default;
     
+    unsigned int getVAO() const override {
+        return VAO;
+    }
+    
     /*
      This will probably be taken out when on-the-fly shader program changes are necessary. (Seems like this is a classic view component).
      Idea: A container that wraps an shape and a shader program...
@@ -71,9 +75,9 @@ public:
      The shader and the mesh data are coupled anyway, as the shader needs to know what the format of
      the incoming data is.
      */
-    virtual void render(ShaderProgram shaderProgram) override {
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
+    virtual void render(ShaderProgram& shaderProgram) override {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
         if (texture) {
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, texture);
@@ -83,6 +87,15 @@ public:
         //Shape::renderAABB(getAABB(), shaderProgram);
     }
     
+    void renderInstanced(ShaderProgram& shaderProgram, int nInstances) override {
+        if (texture) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, texture);
+        }
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, nInstances);
+    }
+    
     std::shared_ptr<Shape> clone() override {
         auto retval =  std::shared_ptr<Cube>(new Cube(*this));
         retval->referenceToThis = retval;
@@ -0,0 +1,78 @@
+//
+//  frustum.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef frustum_h
+#define frustum_h
+
+#include <glm.hpp>
+#include <array>
+#include <cmath>
+
+#include "aabb.h"
+
+/*
+ The six planes of a view volume, pulled straight out of a projection * view (* model) matrix (Gribb and
+ Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"). They come out in
+ whatever space the matrix starts from, so with the model matrix in there the culling can happen in model space.
+ Normals point inwards and are unit length, so a plane's value at a point is its signed distance.
+ */
+struct Frustum {
+    std::array<glm::vec4, 6> planes{};
+    
+    Frustum() = default;
+    
+    explicit Frustum(const glm::mat4& matrix) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; ++i) {
+            rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+        }
+        //left, right, bottom, top, near, far
+        planes[0] = rows[3] + rows[0];
+        planes[1] = rows[3] - rows[0];
+        planes[2] = rows[3] + rows[1];
+        planes[3] = rows[3] - rows[1];
+        planes[4] = rows[3] + rows[2];
+        planes[5] = rows[3] - rows[2];
+        for (glm::vec4& plane : planes) {
+            float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            if (length > 0.0f) {
+                plane = plane / length;
+            }
+        }
+    }
+    
+    static float distance(const glm::vec4& plane, const glm::vec3& point) {
+        return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+    }
+    
+    bool intersectsSphere(const glm::vec3& centre, float radius) const {
+        for (const glm::vec4& plane : planes) {
+            if (distance(plane, centre) < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    //the box's corner furthest along each plane's normal says if it's outside, the nearest if it's inside
+    Containment classify(const AABB& box) const {
+        Containment result = Containment::INSIDE;
+        for (const glm::vec4& plane : planes) {
+            glm::vec3 furthest(plane.x >= 0.0f ? box.max.x : box.min.x, plane.y >= 0.0f ? box.max.y : box.min.y, plane.z >= 0.0f ? box.max.z : box.min.z);
+            if (distance(plane, furthest) < 0.0f) {
+                return Containment::OUTSIDE;
+            }
+            glm::vec3 nearest(plane.x >= 0.0f ? box.min.x : box.max.x, plane.y >= 0.0f ? box.min.y : box.max.y, plane.z >= 0.0f ? box.min.z : box.max.z);
+            if (distance(plane, nearest) < 0.0f) {
+                result = Containment::PARTIAL;
+            }
+        }
+        return result;
+    }
+};
+
+#endif /* frustum_h */
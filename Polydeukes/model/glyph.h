@@ -15,18 +15,26 @@
 #include <glad/glad.h>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
 #include "../view/screenheight.h"
 #include "ttfinterpreter.h"
 #include "spline.h"
 #include "sphere.h"
+#include "threadpool.h"
+#include "glyphsdf.h"
+#include "glyphatlas.h"
 #include <stdexcept>
 
 unsigned int GRANULARITY = 50;
 
+//controlPoints four to a curve, each with its own ends, as computeGlyphFromTTFont lays them out
 std::vector<glm::vec3> computeBezierCurve(std::vector<glm::vec3>& controlPoints) {
     std::array<glm::vec3, 4> currentCurve;
     std::vector<glm::vec3> positions{};
-    for (int i = 0; i < controlPoints.size()-3; i+=3) {
+    for (int i = 0; i + 3 < controlPoints.size(); i+=4) {
         currentCurve[0] = controlPoints[i];
         currentCurve[1] = controlPoints[i+1];
         currentCurve[2] = controlPoints[i+2];
@@ -92,7 +100,7 @@ public:
         setModelingTransform(glm::mat4(transform * modellingTransform * addedTransform));
     }
     
-    Glyph(const Glyph& that) : Shape(that), addedTransform(that.addedTransform), advanceWidth(that.advanceWidth), unitsPerEm(that.unitsPerEm), leftSideBearing(that.leftSideBearing) {
+    Glyph(const Glyph& that) : Shape(that), addedTransform(that.addedTransform), unitsPerEm(that.unitsPerEm), advanceWidth(that.advanceWidth), leftSideBearing(that.leftSideBearing) {
         for (int i = 0; i < 4; ++i) {
             emSpaceBoundingBox[i] = that.emSpaceBoundingBox[i];
         }
@@ -128,68 +136,42 @@ class SimpleGlyph : public Glyph {
     friend FontManager;
     friend FontLoader;
 private:
-    GLuint vao, vbo, ebo, sdfTexture;
+    GLuint vao, vbo, ebo;
+    //where in the font's GlyphAtlas its SDF went
+    GlyphAtlas::Region region{};
     int numEdges{};
     bool bInitialized = false;
-    float sdfData[64 * 64]{};
+    GlyphSDF::Mode mode = GlyphSDF::Mode::FLATTENED;
+    //64x64 floats, or in Mode::MSDF msdfSize squared RGB bytes (a 32 one is 3 KB to the floats' 16); let go of
+    //once they're in the atlas
+    std::vector<float> sdfData{};
+    std::vector<unsigned char> msdfData{};
+    int msdfSize = 0;
+    //how far either side of the outline the channels go, in em units, for the shader to decode them with
+    float msdfRange = 0.0f;
     std::vector<std::vector<glm::vec3>> controlPoints{};
+    //the outline the SDF is made from, flattened or as the font has it, shared with clones
+    std::shared_ptr<const std::vector<glm::vec4>> edges{};
+    std::shared_ptr<const std::vector<GlyphSDF::Quadratic>> quadratics{};
     int index = -1;
     
-    SimpleGlyph(const SimpleGlyph& that) : Glyph(that), numEdges(that.numEdges), vao(that.vao), vbo(that.vbo), ebo(that.ebo), sdfTexture(that.sdfTexture), bInitialized(that.bInitialized), controlPoints(that.controlPoints) {
+    SimpleGlyph(const SimpleGlyph& that) : Glyph(that), vao(that.vao), vbo(that.vbo), ebo(that.ebo), region(that.region), numEdges(that.numEdges), bInitialized(that.bInitialized), mode(that.mode), msdfSize(that.msdfSize), msdfRange(that.msdfRange), controlPoints(that.controlPoints), edges(that.edges), quadratics(that.quadratics) {
         if (!that.bInitialized) {
-            for (int i = 0; i < 64; ++i) {
-                for (int j = 0; j < 64; ++j) {
-                    sdfData[j * 64 + i] = that.sdfData[j*64 + i];
-                }
-            }
+            sdfData = that.sdfData;
+            msdfData = that.msdfData;
         }
         index = that.index;
     }
     
-    float computeSignedDistance(glm::vec2 p, std::vector<glm::vec4>& edges, int numEdges) {
-        float minDist = std::numeric_limits<float>::max();
-        bool inside = false;
-        int windingNumber = 0;
-        for (int i = 0; i < numEdges; ++i) {
-            glm::vec2 a = glm::vec2(edges[i].x, edges[i].y);
-            glm::vec2 b = glm::vec2(edges[i].z, edges[i].w);
-            
-            // Compute the distance from p to line segment (a, b)
-            glm::vec2 ab = b - a;
-            glm::vec2 ap = p - a;
-            float t = glm::clamp(glm::dot(ap, ab) / glm::dot(ab, ab), 0.0f, 1.0f);
-            glm::vec2 closest = a + t * ab;
-            float dist = glm::length(closest - p);
-
-            // Keep track of the minimum distance
-            minDist = glm::min(minDist, dist);
-
-            // Inside-outside test (winding rule)
-            if (a.y <= p.y) {
-                if (b.y > p.y && (b.x - a.x) * (p.y - a.y) > (p.x - a.x) * (b.y - a.y))
-                    windingNumber++;
-            } else {
-                if (b.y <= p.y && (b.x - a.x) * (p.y - a.y) < (p.x - a.x) * (b.y - a.y))
-                    windingNumber--;
-            }
-        }
-        inside = (windingNumber != 0);
-        return inside ? -minDist : minDist;
-    }
-    
     void init() override {
-        glGenTextures(1, &sdfTexture);
-        glBindTexture(GL_TEXTURE_2D, sdfTexture);
-
-        // Allocate storage for the SDF texture
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 64, 64, 0, GL_RED, GL_FLOAT, nullptr);
-
-        // Set texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 64, 64, GL_RED, GL_FLOAT, sdfData);
+        if (mode == GlyphSDF::Mode::MSDF) {
+            region = GlyphAtlas::getInstance(GlyphAtlas::Format::RGB8).insert(msdfSize, msdfSize, msdfData.data());
+        }
+        else {
+            region = GlyphAtlas::getInstance(GlyphAtlas::Format::R32F).insert(GlyphSDF::SIZE, GlyphSDF::SIZE, sdfData.data());
+        }
+        std::vector<float>().swap(sdfData);
+        std::vector<unsigned char>().swap(msdfData);
 
         unsigned int indices[] = {
             0, 1, 2,
@@ -230,7 +212,9 @@ private:
         }
     }
     
-    SimpleGlyph(const std::vector<std::vector<glm::vec2>>& emSpaceBezierPaths, std::vector<std::vector<glm::vec3>> controlPoints, int index, int* emSpaceBoundingBox, int unitsPerEm, unsigned short advanceWidth, short leftSideBearing) : index(index)
+    //emSpaceBezierPaths can be empty unless it's Mode::FLATTENED, the others measure the quadratics (whose
+    //contours end at contourEnds); msdfSize is only for Mode::MSDF
+    SimpleGlyph(const std::vector<std::vector<glm::vec2>>& emSpaceBezierPaths, std::vector<GlyphSDF::Quadratic> quadratics, const std::vector<int>& contourEnds, GlyphSDF::Mode mode, int msdfSize, std::vector<std::vector<glm::vec3>> controlPoints, int index, int* emSpaceBoundingBox, int unitsPerEm, unsigned short advanceWidth, short leftSideBearing) : index(index)
     {
         this->advanceWidth = advanceWidth;
         this->leftSideBearing = leftSideBearing;
@@ -238,45 +222,36 @@ private:
             this->emSpaceBoundingBox[i] = emSpaceBoundingBox[i];
         }
         this->controlPoints = controlPoints;
-        std::vector<glm::vec4> edges{};
-        std::vector<glm::vec2> polygon{};
+        auto edges = std::make_shared<std::vector<glm::vec4>>();
         for (auto path : emSpaceBezierPaths) {
             for (int i = 0; i < path.size(); ++i) {
                 int next = i + 1;
                 if (i == path.size()-1) {
                     next = 0;
                 }
-                edges.push_back(glm::vec4(path[i].x, path[i].y, path[next].x, path[next].y));
-                polygon.push_back(glm::vec2(path[i].x, path[i].y));
+                edges->push_back(glm::vec4(path[i].x, path[i].y, path[next].x, path[next].y));
             }
         }
-        numEdges = (int)edges.size();
-        //compute the bounding box
-        float minX = std::numeric_limits<float>::max();
-        float minY = std::numeric_limits<float>::max();
-        float maxX = -1 * std::numeric_limits<float>::max();
-        float maxY = -1 * std::numeric_limits<float>::max();
-        for (const auto& vertex : polygon) {
-            minX = std::min(minX, vertex.x);
-            minY = std::min(minY, vertex.y);
-            maxX = std::max(maxX, vertex.x);
-            maxY = std::max(maxY, vertex.y);
-        }
-                
-        float cellSizeY = (maxY - minY) / 64.f;
-        float cellSizeX = (maxX - minX) / 64.f;
-        for (int i = 0; i < 64; ++i) {
-            for (int j = 0; j < 64; ++j) {
-                float emX = minX + i * cellSizeX;
-                float emY = minY + j * cellSizeY;
-                glm::vec2 gridPoint = glm::vec2(emX, emY);
-
-                // Compute SDF value (distance to nearest glyph edge)
-                float sdf = computeSignedDistance(gridPoint, edges, numEdges);
-
-                sdfData[j * 64 + i] = sdf;  // Store in row-major order
-            }
+        static_assert(GlyphSDF::SIZE == 64, "sdfData and the texture are 64x64");
+        this->mode = mode;
+        this->quadratics = std::make_shared<const std::vector<GlyphSDF::Quadratic>>(std::move(quadratics));
+        if (mode == GlyphSDF::Mode::MSDF) {
+            numEdges = (int)this->quadratics->size();
+            this->msdfSize = std::clamp(msdfSize, GlyphSDF::MSDF_MIN_SIZE, GlyphSDF::MSDF_MAX_SIZE);
+            msdfData.resize(this->msdfSize * this->msdfSize * 3);
+            msdfRange = GlyphSDF::computeMultichannel(*this->quadratics, contourEnds, this->msdfSize, msdfData.data());
         }
+        else if (mode == GlyphSDF::Mode::QUADRATIC) {
+            numEdges = (int)this->quadratics->size();
+            sdfData.resize(GlyphSDF::SIZE * GlyphSDF::SIZE);
+            GlyphSDF::computeQuadratic(*this->quadratics, sdfData.data());
+        }
+        else {
+            numEdges = (int)edges->size();
+            sdfData.resize(GlyphSDF::SIZE * GlyphSDF::SIZE);
+            GlyphSDF::compute(*edges, sdfData.data());
+        }
+        this->edges = edges;
     }
     
 protected:
@@ -302,6 +277,27 @@ public:
         return index;
     }
     
+    //empty unless the font was loaded with Mode::FLATTENED
+    const std::vector<glm::vec4>& getEdges() const {
+        return *edges;
+    }
+    
+    const std::vector<GlyphSDF::Quadratic>& getQuadratics() const {
+        return *quadratics;
+    }
+    
+    unsigned int getVAO() const override {
+        return bInitialized ? vao : 0;
+    }
+    
+    unsigned int getTexture() const override {
+        return bInitialized ? region.texture : 0;
+    }
+    
+    const GlyphAtlas::Region& getAtlasRegion() const {
+        return region;
+    }
+    
     void setModelingTransform(glm::mat4&& transform) override {
         Shape::setModelingTransform(transform);
         for (auto& spline : controlPoints) {
@@ -311,21 +307,25 @@ public:
         }
     }
     
-    void render(ShaderProgram shaderProgram) override {
+    void render(ShaderProgram& shaderProgram) override {
         if (!bInitialized) {
             init();
         }
         shaderProgram.setVec2("resolution", glm::vec2(ScreenHeight::screen_width,ScreenHeight::screen_height));
         shaderProgram.setVec2("minBounds", glm::vec2(emSpaceBoundingBox[0],emSpaceBoundingBox[1]));
         shaderProgram.setVec2("maxBounds", glm::vec2(emSpaceBoundingBox[2],emSpaceBoundingBox[3]));
-        shaderProgram.setVec3("aColour", colour);
+        shaderProgram.setVec4("uvRect", region.uvRect);
+        shaderProgram.set(shaderProgram.colour, colour);
         float timeValue = glfwGetTime();
         shaderProgram.setFloat("uTime", timeValue);
         glm::mat4 tmp = modellingTransform * addedTransform;
         shaderProgram.setMat4("model", tmp);
         float threshold = 2.f;
         shaderProgram.setFloat("threshold", threshold);
-        glBindTexture(GL_TEXTURE_2D, sdfTexture);
+        if (mode == GlyphSDF::Mode::MSDF) {
+            shaderProgram.setFloat("distanceRange", msdfRange);
+        }
+        glBindTexture(GL_TEXTURE_2D, region.texture);
         glBindVertexArray(vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     }
@@ -417,7 +417,7 @@ public:
         }
     }
     
-    void render(ShaderProgram shaderProgram) override {
+    void render(ShaderProgram& shaderProgram) override {
         for (auto& glyph : childGlyphs) {
             glyph.glyph->render(shaderProgram);
         }
@@ -427,7 +427,7 @@ public:
 class FontManager {
     friend FontLoader;
 private:
-    std::vector<int> requestedGlyphs{};
+    std::unordered_set<int> requestedGlyphs{};
     
     class CMap {
         
@@ -523,51 +523,90 @@ private:
         }
     };
     
-    struct GlyphWithIndex {
-        std::shared_ptr<Shape> glyph{};
-        int index;
-        
-        GlyphWithIndex(std::shared_ptr<Shape> glyph, int index) : glyph(glyph), index(index) {}
-    };
-    std::vector<GlyphWithIndex> theFont{};
-    
-    void put(std::shared_ptr<Shape> glyph, int index) {
-        int eraseIndex = -1;
-        for (int i = 0; i < theFont.size(); ++i) {
-            if (theFont[i].index == index) {
-                eraseIndex = i;
-                break;
+    /*
+     One slot per glyph in the font's insertion order, filled in by FontLoader's workers while get() may already
+     be running on the render thread, hence the mutex. get() goes by glyph index, so that's kept alongside.
+     */
+    std::vector<std::shared_ptr<Shape>> theFont{};
+    std::unordered_map<int, int> slotOfGlyphIndex{};
+    mutable std::mutex mutex;
+    int nGlyphs = 0;
+    std::atomic<int> nCompiled{0};
+    std::promise<void> readyPromise{};
+    std::shared_future<void> ready = readyPromise.get_future().share();
+    
+    //before any put, how many glyphs are coming
+    void expect(int nGlyphs) {
+        this->nGlyphs = nGlyphs;
+        theFont.assign(nGlyphs, nullptr);
+        if (nGlyphs == 0) {
+            readyPromise.set_value();
+        }
+    }
+    
+    //glyph may be null if it failed to compile, it still counts towards being ready
+    void put(std::shared_ptr<Glyph> glyph, int index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (index >= (int)theFont.size()) {
+                theFont.resize(index + 1);
+            }
+            theFont[index] = glyph;
+            if (glyph) {
+                slotOfGlyphIndex[glyph->getIndex()] = index;
             }
         }
-        if (eraseIndex >= 0) {
-            theFont.erase(theFont.begin() + eraseIndex);
+        if (++nCompiled == nGlyphs) {
+            readyPromise.set_value();
         }
-        theFont.push_back(GlyphWithIndex(glyph, index));
     }
     
     CMap cmap;
     
 public:
     const int unitsPerEm;
-    bool bReady = false;
+    //what its glyphs' SDFs were measured against
+    const GlyphSDF::Mode sdfMode;
     
-    FontManager(std::vector<char> cmapData, int unitsPerEm) : cmap{CMap(cmapData)}, unitsPerEm(unitsPerEm) {}
+    FontManager(std::vector<char> cmapData, int unitsPerEm, GlyphSDF::Mode sdfMode = GlyphSDF::Mode::FLATTENED) : cmap{CMap(cmapData)}, unitsPerEm(unitsPerEm), sdfMode(sdfMode) {}
     
+    //null if it isn't compiled (yet)
     std::shared_ptr<Shape> get(int index) {
-        for (auto gi : theFont) {
-            auto g = std::dynamic_pointer_cast<Glyph>(gi.glyph);
-            if (g->getIndex() == index) {
-                if (gi.glyph == nullptr) {
-                    return nullptr;
-                }
-                if (std::find(requestedGlyphs.cbegin(), requestedGlyphs.cend(), index) == requestedGlyphs.cend()) {
-                    requestedGlyphs.push_back(index);
-                    g->init();
-                }
-                return gi.glyph->clone();
-            }
+        std::lock_guard<std::mutex> lock(mutex);
+        auto slot = slotOfGlyphIndex.find(index);
+        if (slot == slotOfGlyphIndex.end()) {
+            return nullptr;
         }
-        return nullptr;
+        std::shared_ptr<Shape> glyph = theFont[slot->second];
+        if (requestedGlyphs.insert(index).second) {
+            std::static_pointer_cast<Glyph>(glyph)->init();
+        }
+        return glyph->clone();
+    }
+    
+    bool isReady() const {
+        return nCompiled >= nGlyphs;
+    }
+    
+    int getCompiledCount() const {
+        return nCompiled;
+    }
+    
+    int getGlyphCount() const {
+        return nGlyphs;
+    }
+    
+    //instead of polling isReady
+    void waitUntilReady() const {
+        ready.wait();
+    }
+    
+    std::shared_future<void> whenReady() const {
+        return ready;
+    }
+    
+    GlyphSDF::Mode getSDFMode() const {
+        return sdfMode;
     }
     
     std::shared_ptr<Glyph> getFromUnicode(int codePoint) {
@@ -580,8 +619,6 @@ public:
 class FontLoader {
 private:
     
-    static int nDone;
-    
     static void readlbpFontFile(std::string pathToGlyph, std::vector<std::vector<std::vector<glm::vec3>>>& bezierPaths) {
         std::ifstream ifs(pathToGlyph);
         if (ifs.is_open()) {
@@ -672,15 +709,16 @@ private:
     
 public:
     
-    static bool bReady;
+    //glyphs per pool task, enough that a task isn't mostly queueing overhead and few enough to spread a small font
+    static constexpr int MAX_GLYPHS_PER_BATCH = 64;
     
-    static std::shared_ptr<Glyph> computeGlyphFromTTFont(TTFont& font, int insertionIndex) {
+    static std::shared_ptr<Glyph> computeGlyphFromTTFont(TTFont& font, int insertionIndex, GlyphSDF::Mode mode = GlyphSDF::Mode::FLATTENED, int msdfSize = GlyphSDF::MSDF_SIZE) {
         int glyphIndex = font.insertionIndexToGlyphIndex(insertionIndex);
         if (font.isCompound(insertionIndex)) {
             TTFCompoundGlyph cg = font.getCompoundGlyph(insertionIndex);
             std::vector<GlyphAndTransform> gats;
             for (auto ttfgat : cg.gats) {
-                auto subglyph = computeGlyphFromTTFont(font, font.glyphIndexToInsertionIndex(ttfgat.glyphIndex));
+                auto subglyph = computeGlyphFromTTFont(font, font.glyphIndexToInsertionIndex(ttfgat.glyphIndex), mode, msdfSize);
                 GlyphAndTransform gat;
                 gat.transform = ttfgat.transform;
                 gat.glyph = subglyph;
@@ -709,6 +747,8 @@ public:
         std::vector<Point> contour{};
         std::vector<std::shared_ptr<SplineCurve>> splines{};
         std::vector<std::vector<glm::vec2>> emSpaceBezierPaths{};
+        std::vector<GlyphSDF::Quadratic> quadratics{};
+        std::vector<int> contourEnds{};
         for (int i = 0; i < absContours.size(); ++i) {
             std::vector<glm::vec3> contourControlPoints{};
             for (int k = 0; k < absContours[i].points.size(); ++k) {
@@ -720,95 +760,97 @@ public:
                 }
                 contour.push_back(absContours[i].points[k]);
             }
-            if (!contour[0].onCurve) {
-                if (!contour[1].onCurve) {
-                    throw std::exception();
-                }
-                for (int k = 1; k < contour.size()-2; k += 2) {
-                    glm::vec3 offCurvePoint = glm::vec3(contour[k+1].xCoord, contour[k+1].yCoord, 0.f);
-                    glm::vec3 first =  glm::vec3(contour[k].xCoord, contour[k].yCoord, 0.f);
-                    glm::vec3 second =  first * 1.f/3.f + offCurvePoint * 2.f/3.f;
-                    glm::vec3 fourth =  glm::vec3(contour[k+2].xCoord, contour[k+2].yCoord, 0.f);
-                    glm::vec3 third =  offCurvePoint * 2.f/3.f + fourth * 1.f/3.f;
-                    contourControlPoints.push_back(first);
-                    contourControlPoints.push_back(second);
-                    contourControlPoints.push_back(third);
-                    contourControlPoints.push_back(fourth);
-                }
-                glm::vec3 first =  glm::vec4(contour.back().xCoord, contour.back().yCoord, 0.f, 1.f);
-                glm::vec3 offCurvePoint = glm::vec3(contour[0].xCoord, contour[0].yCoord, 0.f);
+            //a quadratic piece of the outline, kept as it is and raised to the cubic everything else draws with
+            auto addCurve = [&](glm::vec3 first, glm::vec3 offCurvePoint, glm::vec3 fourth) {
                 glm::vec3 second =  first * 1.f/3.f + offCurvePoint * 2.f/3.f;
-                glm::vec3 fourth =  glm::vec4(contour[1].xCoord, contour[1].yCoord, 0.f,1.f);
                 glm::vec3 third =  offCurvePoint * 2.f/3.f + fourth * 1.f/3.f;
                 contourControlPoints.push_back(first);
                 contourControlPoints.push_back(second);
                 contourControlPoints.push_back(third);
                 contourControlPoints.push_back(fourth);
+                quadratics.push_back({glm::vec2(first), glm::vec2(offCurvePoint), glm::vec2(fourth)});
+            };
+            if (!contour[0].onCurve) {
+                if (!contour[1].onCurve) {
+                    throw std::exception();
+                }
+                for (int k = 1; k < contour.size()-2; k += 2) {
+                    addCurve(glm::vec3(contour[k].xCoord, contour[k].yCoord, 0.f), glm::vec3(contour[k+1].xCoord, contour[k+1].yCoord, 0.f), glm::vec3(contour[k+2].xCoord, contour[k+2].yCoord, 0.f));
+                }
+                addCurve(glm::vec3(contour.back().xCoord, contour.back().yCoord, 0.f), glm::vec3(contour[0].xCoord, contour[0].yCoord, 0.f), glm::vec3(contour[1].xCoord, contour[1].yCoord, 0.f));
             } else {
                 if (contour[1].onCurve) {
                     throw std::exception();
                 }
                 for (int k = 0; k < contour.size()-2; k += 2) {
-                    glm::vec3 offCurvePoint = glm::vec3(contour[k+1].xCoord, contour[k+1].yCoord, 0.f);
-                    glm::vec3 first =  glm::vec3(contour[k].xCoord, contour[k].yCoord, 0.f);
-                    glm::vec3 second =  first * 1.f/3.f + offCurvePoint * 2.f/3.f;
-                    glm::vec3 fourth =  glm::vec3(contour[k+2].xCoord, contour[k+2].yCoord, 0.f);
-                    glm::vec3 third =  offCurvePoint * 2.f/3.f + fourth * 1.f/3.f;
-                    contourControlPoints.push_back(first);
-                    contourControlPoints.push_back(second);
-                    contourControlPoints.push_back(third);
-                    contourControlPoints.push_back(fourth);
+                    addCurve(glm::vec3(contour[k].xCoord, contour[k].yCoord, 0.f), glm::vec3(contour[k+1].xCoord, contour[k+1].yCoord, 0.f), glm::vec3(contour[k+2].xCoord, contour[k+2].yCoord, 0.f));
                 }
-                glm::vec3 first =  glm::vec3(contour[contour.size()-2].xCoord, contour[contour.size()-2].yCoord, 0.f);
-                glm::vec3 offCurvePoint = glm::vec3(contour.back().xCoord, contour.back().yCoord, 0.f);
-                glm::vec3 second =  first * 1.f/3.f + offCurvePoint * 2.f/3.f;
-                glm::vec3 fourth =  glm::vec4(contour[0].xCoord, contour[0].yCoord, 0.f,1.f);
-                glm::vec3 third =  offCurvePoint * 2.f/3.f + fourth * 1.f/3.f;
-                contourControlPoints.push_back(first);
-                contourControlPoints.push_back(second);
-                contourControlPoints.push_back(third);
-                contourControlPoints.push_back(fourth);
+                addCurve(glm::vec3(contour[contour.size()-2].xCoord, contour[contour.size()-2].yCoord, 0.f), glm::vec3(contour.back().xCoord, contour.back().yCoord, 0.f), glm::vec3(contour[0].xCoord, contour[0].yCoord, 0.f));
             }
-            std::vector<glm::vec3> tmp = computeBezierCurve(contourControlPoints);
-            std::vector<glm::vec2> tmp2{};
-            for (auto e : tmp) {
-                tmp2.push_back(e);
+            //the quadratic SDF doesn't need the flattened outline at all
+            if (mode == GlyphSDF::Mode::FLATTENED) {
+                std::vector<glm::vec3> tmp = computeBezierCurve(contourControlPoints);
+                std::vector<glm::vec2> tmp2{};
+                for (auto e : tmp) {
+                    tmp2.push_back(e);
+                }
+                emSpaceBezierPaths.push_back(tmp2);
             }
-            emSpaceBezierPaths.push_back(tmp2);
             controlPoints.push_back(contourControlPoints);
+            contourEnds.push_back((int)quadratics.size());
             contour.clear();
         }
-        auto fill = std::shared_ptr<SimpleGlyph>(new SimpleGlyph(emSpaceBezierPaths, controlPoints, glyph.index, glyph.boundingBox, font.unitsPerEm, glyph.advanceWidth, glyph.leftSideBearing));
+        auto fill = std::shared_ptr<SimpleGlyph>(new SimpleGlyph(emSpaceBezierPaths, std::move(quadratics), contourEnds, mode, msdfSize, controlPoints, glyph.index, glyph.boundingBox, font.unitsPerEm, glyph.advanceWidth, glyph.leftSideBearing));
         return fill;
     }
     
-    static std::shared_ptr<FontManager> loadFont(TTFont& font, std::vector<std::function<void(std::shared_ptr<Glyph>)>> callbacks) {
-        std::shared_ptr<FontManager> manager = std::shared_ptr<FontManager>(new FontManager(font.mapTableData, font.unitsPerEm));
-        auto vec_mutex_ptr = std::make_shared<std::mutex>();
-        for (int i = 0; i < font.getNGlyphs(); ++i) {
-            std::thread([&font, manager, i, vec_mutex_ptr, callbacks, nGlyphs = font.getNGlyphs()]() {
-                auto glyph = computeGlyphFromTTFont(font, i);
-                if (i < (int)callbacks.size()) {
-                    callbacks[i](glyph);
-                }
-                std::lock_guard<std::mutex> lock(*vec_mutex_ptr);
-                manager->put(glyph, i);
-                ++nDone;
-                if (nDone == nGlyphs - 1) {
-                    manager->bReady = true;
+    //a glyph the outline code chokes on comes back null rather than taking its batch (and the readiness) down
+    static std::shared_ptr<Glyph> compileGlyph(TTFont& font, int insertionIndex, GlyphSDF::Mode mode = GlyphSDF::Mode::FLATTENED, int msdfSize = GlyphSDF::MSDF_SIZE) {
+        try {
+            return computeGlyphFromTTFont(font, insertionIndex, mode, msdfSize);
+        }
+        catch (const std::exception&) {
+            std::cerr << "Failed to compile glyph " << insertionIndex << std::endl;
+            return nullptr;
+        }
+    }
+    
+    /*
+     Compiles the font's glyphs on the pool, in batches of consecutive indices, and hands back the manager
+     straight away: wait on it (waitUntilReady/whenReady) or take the glyphs as they come through callbacks[i],
+     which gets glyph i on whichever pool thread compiled it. The font is copied, the caller's can go.
+     mode picks what the glyphs' SDFs are measured against, see GlyphSDF; a Mode::MSDF font is msdfSize texels
+     a side (16 to 128) and draws with glyphmsdffs.glsl instead of glyphfs.glsl.
+     */
+    static std::shared_ptr<FontManager> loadFont(TTFont& font, std::vector<std::function<void(std::shared_ptr<Glyph>)>> callbacks, GlyphSDF::Mode mode = GlyphSDF::Mode::FLATTENED, int msdfSize = GlyphSDF::MSDF_SIZE) {
+        std::shared_ptr<FontManager> manager = std::shared_ptr<FontManager>(new FontManager(font.mapTableData, font.unitsPerEm, mode));
+        int nGlyphs = font.getNGlyphs();
+        manager->expect(nGlyphs);
+        auto source = std::make_shared<TTFont>(font);
+        auto sharedCallbacks = std::make_shared<const std::vector<std::function<void(std::shared_ptr<Glyph>)>>>(std::move(callbacks));
+        ThreadPool& pool = ThreadPool::getInstance();
+        int batchSize = std::clamp(nGlyphs / (4 * ((int)pool.size() + 1)), 1, MAX_GLYPHS_PER_BATCH);
+        for (int first = 0; first < nGlyphs; first += batchSize) {
+            int last = std::min(nGlyphs, first + batchSize);
+            pool.submit([source, manager, sharedCallbacks, first, last, mode, msdfSize] {
+                for (int i = first; i < last; ++i) {
+                    auto glyph = compileGlyph(*source, i, mode, msdfSize);
+                    if (glyph && i < (int)sharedCallbacks->size() && (*sharedCallbacks)[i]) {
+                        (*sharedCallbacks)[i](glyph);
+                    }
+                    manager->put(glyph, i);
                 }
-            }).detach();
+            });
         }
         return manager;
     }
     
     static std::shared_ptr<FontManager> loadFont(TTFont& font) {
         std::shared_ptr<FontManager> manager = std::shared_ptr<FontManager>(new FontManager(font.mapTableData, font.unitsPerEm));
+        manager->expect(font.getNGlyphs());
         for (int i = 0; i < font.getNGlyphs(); ++i) {
-            auto glyph = computeGlyphFromTTFont(font, i);
-            manager->put(glyph, i);
+            manager->put(compileGlyph(font, i), i);
         }
-        manager->bReady = true;
         return manager;
     }
     
@@ -822,8 +864,6 @@ public:
     
 };
 
-int FontLoader::nDone = 0;
-
 #include <cmath>
 
 class WordCircle : public Shape {
@@ -917,7 +957,7 @@ public:
     
     float lastTime = 0;
     
-    void render(ShaderProgram shaderProgram) override {
+    void render(ShaderProgram& shaderProgram) override {
         auto time = glfwGetTime();
         float deltaAngle = (time - lastTime);
         glm::mat4 deltaRotation = glm::rotate(glm::mat4(1.f), deltaAngle, glm::vec3(0, 1, 0));
@@ -0,0 +1,231 @@
+//
+//  glyphatlas.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef glyphatlas_h
+#define glyphatlas_h
+
+#include <glad/glad.h>
+#include <glm.hpp>
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <iostream>
+
+/*
+ Where glyphs keep their SDFs on the GPU: a few big textures (pages) with many glyphs in each, instead of a
+ texture per glyph, so a page of text binds a texture or two rather than one a character. A glyph gets back a
+ Region, the page's texture and the UV rectangle it's at, and glyphvs.glsl maps its quad onto that.
+ 
+ Each page is packed with a skyline, the outline of the tops of what's been placed so far, left to right. A new
+ glyph goes wherever its top ends up lowest. Glyphs of a font are all the same size so it packs them in rows,
+ but MSDF fonts of different sizes share the RGB8 atlas and the skyline doesn't mind. When no page has room a
+ new one is added. Nothing's ever taken out, fonts stay loaded for the life of the program.
+ 
+ One atlas per texel format, render thread only (SimpleGlyph::init is where glyphs go in).
+ */
+class GlyphAtlas {
+public:
+    enum class Format {R32F, RGB8};
+    
+    static constexpr int PAGE_SIZE = 1024;
+    //a glyph's edge texels are copied out this far round it, so linear filtering at its border doesn't pick
+    //up the neighbours, same as clamping to the edge did when it had a texture to itself
+    static constexpr int PADDING = 1;
+    
+    struct Region {
+        unsigned int texture = 0;
+        int page = -1;
+        //min u, min v, max u, max v
+        glm::vec4 uvRect{0.0f, 0.0f, 1.0f, 1.0f};
+    };
+
+private:
+    class Skyline {
+        struct Node {
+            int x;
+            int y;
+            int width;
+        };
+        
+        int size;
+        //left to right, covering the page's width
+        std::vector<Node> nodes;
+        
+        //where the bottom of a rect starting at node i would rest, false if it'd go off the page
+        bool fit(int i, int width, int height, int& y) const {
+            if (nodes[i].x + width > size) {
+                return false;
+            }
+            y = 0;
+            for (int j = i, remaining = width; remaining > 0; ++j) {
+                y = std::max(y, nodes[j].y);
+                if (y + height > size) {
+                    return false;
+                }
+                remaining -= nodes[j].width;
+            }
+            return true;
+        }
+    
+    public:
+        Skyline(int size) : size(size), nodes{{0, 0, size}} {}
+        
+        bool insert(int width, int height, int& x, int& y) {
+            int best = -1;
+            int bestTop = INT_MAX;
+            for (int i = 0; i < (int)nodes.size(); ++i) {
+                int bottom;
+                //strictly lower, so it's the leftmost of a tie
+                if (fit(i, width, height, bottom) && bottom + height < bestTop) {
+                    best = i;
+                    bestTop = bottom + height;
+                    x = nodes[i].x;
+                    y = bottom;
+                }
+            }
+            if (best == -1) {
+                return false;
+            }
+            nodes.insert(nodes.begin() + best, Node{x, bestTop, width});
+            //whatever it overhangs is cut back to its right edge
+            for (int j = best + 1; j < (int)nodes.size();) {
+                int overlap = x + width - nodes[j].x;
+                if (overlap <= 0) {
+                    break;
+                }
+                if (overlap < nodes[j].width) {
+                    nodes[j].x += overlap;
+                    nodes[j].width -= overlap;
+                    break;
+                }
+                nodes.erase(nodes.begin() + j);
+            }
+            for (int j = 0; j + 1 < (int)nodes.size();) {
+                if (nodes[j].y == nodes[j + 1].y) {
+                    nodes[j].width += nodes[j + 1].width;
+                    nodes.erase(nodes.begin() + j + 1);
+                }
+                else {
+                    ++j;
+                }
+            }
+            return true;
+        }
+    };
+    
+    struct Page {
+        unsigned int texture;
+        Skyline skyline;
+    };
+    
+    Format format;
+    std::vector<Page> pages{};
+    int nGlyphs = 0;
+    
+    GlyphAtlas(Format format) : format(format) {}
+    
+    int bytesPerTexel() const {
+        return format == Format::RGB8 ? 3 : sizeof(float);
+    }
+    
+    void addPage() {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (format == Format::RGB8) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, PAGE_SIZE, PAGE_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, PAGE_SIZE, PAGE_SIZE, 0, GL_RED, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        pages.push_back(Page{texture, Skyline(PAGE_SIZE)});
+    }
+
+public:
+    
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+    
+    static GlyphAtlas& getInstance(Format format) {
+        static GlyphAtlas r32f(Format::R32F);
+        static GlyphAtlas rgb8(Format::RGB8);
+        return format == Format::RGB8 ? rgb8 : r32f;
+    }
+    
+    /*
+     Render thread. texels are width by height rows of floats for R32F, interleaved bytes for RGB8. Returns an
+     empty region (texture 0) if it can't fit on a page at all.
+     */
+    Region insert(int width, int height, const void* texels) {
+        int paddedWidth = width + 2 * PADDING;
+        int paddedHeight = height + 2 * PADDING;
+        if (paddedWidth > PAGE_SIZE || paddedHeight > PAGE_SIZE) {
+            std::cerr << "A " << width << "x" << height << " glyph is too big for the atlas" << std::endl;
+            return Region{};
+        }
+        int page = 0;
+        int x = 0, y = 0;
+        while (page < (int)pages.size() && !pages[page].skyline.insert(paddedWidth, paddedHeight, x, y)) {
+            ++page;
+        }
+        if (page == (int)pages.size()) {
+            addPage();
+            pages.back().skyline.insert(paddedWidth, paddedHeight, x, y);
+        }
+        
+        int size = bytesPerTexel();
+        std::vector<unsigned char> padded((size_t)paddedWidth * paddedHeight * size);
+        const unsigned char* source = static_cast<const unsigned char*>(texels);
+        for (int row = 0; row < paddedHeight; ++row) {
+            int sourceRow = std::clamp(row - PADDING, 0, height - 1);
+            for (int column = 0; column < paddedWidth; ++column) {
+                int sourceColumn = std::clamp(column - PADDING, 0, width - 1);
+                std::memcpy(&padded[((size_t)row * paddedWidth + column) * size], &source[((size_t)sourceRow * width + sourceColumn) * size], size);
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, pages[page].texture);
+        //rows of RGB bytes needn't be a multiple of 4
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (format == Format::RGB8) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, paddedWidth, paddedHeight, GL_RGB, GL_UNSIGNED_BYTE, padded.data());
+        }
+        else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, paddedWidth, paddedHeight, GL_RED, GL_FLOAT, padded.data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        ++nGlyphs;
+        
+        Region region{};
+        region.texture = pages[page].texture;
+        region.page = page;
+        region.uvRect = glm::vec4(x + PADDING, y + PADDING, x + PADDING + width, y + PADDING + height) / (float)PAGE_SIZE;
+        return region;
+    }
+    
+    Format getFormat() const {
+        return format;
+    }
+    
+    int getPageCount() const {
+        return (int)pages.size();
+    }
+    
+    unsigned int getTexture(int page) const {
+        return pages[page].texture;
+    }
+    
+    int getGlyphCount() const {
+        return nGlyphs;
+    }
+};
+
+#endif /* glyphatlas_h */
@@ -0,0 +1,856 @@
+//
+//  glyphsdf.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef glyphsdf_h
+#define glyphsdf_h
+
+#include <glm.hpp>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "simd.h"
+
+/*
+ The signed distance field a SimpleGlyph draws from: SIZE x SIZE texels over the bounding box of the glyph's
+ flattened outline (edges as (a.x, a.y, b.x, b.y)), negative inside by the non-zero winding rule.
+ 
+ signedDistance is the original, every texel against every edge. compute gets the same field a lot faster:
+ texels go simd::width at a time along a row, the edges are bucketed into a GRID x GRID grid and a row of texels
+ only looks at the cells in growing rings around it until nothing further out could be closer, and the winding
+ only looks at the edges crossing the row's height. The winding test is the same float expression on the same
+ values, so inside/outside comes out identical; the distances can differ in the last bit.
+ 
+ computeQuadratic is the other Mode, the field straight from the TrueType curves with no flattening at all.
+ computeMultichannel is Mode::MSDF, three channels in bytes at a size of the font's choosing, see there.
+ */
+class GlyphSDF {
+public:
+    
+    static constexpr int SIZE = 64;
+    static constexpr int GRID = 16;
+    //texels along a row that computeQuadratic walks the buckets for together
+    static constexpr int BLOCK = 8;
+    
+    static float signedDistance(glm::vec2 p, const std::vector<glm::vec4>& edges) {
+        float minDist = std::numeric_limits<float>::max();
+        bool inside = false;
+        int windingNumber = 0;
+        for (size_t i = 0; i < edges.size(); ++i) {
+            glm::vec2 a = glm::vec2(edges[i].x, edges[i].y);
+            glm::vec2 b = glm::vec2(edges[i].z, edges[i].w);
+            
+            // Compute the distance from p to line segment (a, b)
+            glm::vec2 ab = b - a;
+            glm::vec2 ap = p - a;
+            float t = glm::clamp(glm::dot(ap, ab) / glm::dot(ab, ab), 0.0f, 1.0f);
+            glm::vec2 closest = a + t * ab;
+            float dist = glm::length(closest - p);
+            
+            // Keep track of the minimum distance
+            minDist = glm::min(minDist, dist);
+            
+            // Inside-outside test (winding rule)
+            if (a.y <= p.y) {
+                if (b.y > p.y && (b.x - a.x) * (p.y - a.y) > (p.x - a.x) * (b.y - a.y))
+                    windingNumber++;
+            } else {
+                if (b.y <= p.y && (b.x - a.x) * (p.y - a.y) < (p.x - a.x) * (b.y - a.y))
+                    windingNumber--;
+            }
+        }
+        inside = (windingNumber != 0);
+        return inside ? -minDist : minDist;
+    }
+    
+    //the multi-channel field's texels a side by default and the sizes it can have, and how many texels out
+    //from the outline its channels saturate
+    static constexpr int MSDF_SIZE = 32;
+    static constexpr int MSDF_MIN_SIZE = 16;
+    static constexpr int MSDF_MAX_SIZE = 128;
+    static constexpr float MSDF_RANGE = 4.0f;
+    
+    //what a font's SimpleGlyphs measure their SDF against: the outline flattened into GRANULARITY segments per
+    //curve, or the TrueType quadratics themselves; MSDF is the quadratics too, into three channels
+    enum class Mode {
+        FLATTENED,
+        QUADRATIC,
+        MSDF
+    };
+    
+    //B(t) = (1-t)^2 p0 + 2t(1-t) p1 + t^2 p2, one piece of a TrueType outline
+    struct Quadratic {
+        glm::vec2 p0;
+        glm::vec2 p1;
+        glm::vec2 p2;
+    };
+
+private:
+    
+    //where the texels sit, the glyph's bounding box split SIZE ways
+    struct Frame {
+        float minX = std::numeric_limits<float>::max();
+        float minY = std::numeric_limits<float>::max();
+        float maxX = -std::numeric_limits<float>::max();
+        float maxY = -std::numeric_limits<float>::max();
+        float cellSizeX = 0.0f;
+        float cellSizeY = 0.0f;
+        //0 puts texel i at the start of its cell, 0.5 in the middle of it where GL samples it
+        float offset = 0.0f;
+        
+        explicit Frame(const std::vector<glm::vec4>& edges) {
+            for (const glm::vec4& edge : edges) {
+                include(glm::vec2(edge.x, edge.y));
+            }
+            split();
+        }
+        
+        //the curves' own extent, the ends plus wherever x or y turns round
+        explicit Frame(const std::vector<Quadratic>& curves, int size = SIZE, float offset = 0.0f) : offset(offset) {
+            for (const Quadratic& curve : curves) {
+                include(curve.p0);
+                include(curve.p2);
+                for (int axis = 0; axis < 2; ++axis) {
+                    float denominator = curve.p0[axis] - 2.0f * curve.p1[axis] + curve.p2[axis];
+                    float t = denominator != 0.0f ? (curve.p0[axis] - curve.p1[axis]) / denominator : 0.0f;
+                    if (t > 0.0f && t < 1.0f) {
+                        include(evaluate(curve, t));
+                    }
+                }
+            }
+            split(size);
+        }
+        
+        void include(glm::vec2 p) {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+        
+        void split(int size = SIZE) {
+            cellSizeY = (maxY - minY) / (float)size;
+            cellSizeX = (maxX - minX) / (float)size;
+        }
+        
+        float x(int i) const {
+            return minX + (i + offset) * cellSizeX;
+        }
+        
+        float y(int j) const {
+            return minY + (j + offset) * cellSizeY;
+        }
+    };
+    
+    /*
+     Boxes (min x, min y, max x, max y) put into every cell of a GRID x GRID grid over the frame they touch, as
+     one array with the start of each cell's run. Measuring from a block of cells goes a ring of cells at a time,
+     anything not reached yet is at least ring * getNearestOutside() away.
+     */
+    class Buckets {
+    private:
+        float minX, minY, sizeX, sizeY;
+        std::vector<int> starts = std::vector<int>(GRID * GRID + 1, 0);
+        std::vector<int> items{};
+    
+    public:
+        Buckets(const Frame& frame, const std::vector<glm::vec4>& boxes) : minX(frame.minX), minY(frame.minY) {
+            float extentX = frame.maxX - frame.minX, extentY = frame.maxY - frame.minY;
+            sizeX = extentX > 0.0f ? extentX / GRID : 1.0f;
+            sizeY = extentY > 0.0f ? extentY / GRID : 1.0f;
+            for (int pass = 0; pass < 2; ++pass) {
+                std::vector<int> fill(starts.begin(), starts.end() - 1);
+                for (int e = 0; e < (int)boxes.size(); ++e) {
+                    int column0 = column(boxes[e].x), column1 = column(boxes[e].z);
+                    int row0 = row(boxes[e].y), row1 = row(boxes[e].w);
+                    for (int r = row0; r <= row1; ++r) {
+                        for (int c = column0; c <= column1; ++c) {
+                            if (pass == 0) {
+                                ++starts[r * GRID + c + 1];
+                            }
+                            else {
+                                items[fill[r * GRID + c]++] = e;
+                            }
+                        }
+                    }
+                }
+                if (pass == 0) {
+                    for (int cell = 0; cell < GRID * GRID; ++cell) {
+                        starts[cell + 1] += starts[cell];
+                    }
+                    items.resize(starts.back());
+                }
+            }
+        }
+        
+        int column(float x) const {
+            return std::clamp((int)((x - minX) / sizeX), 0, GRID - 1);
+        }
+        
+        int row(float y) const {
+            return std::clamp((int)((y - minY) / sizeY), 0, GRID - 1);
+        }
+        
+        float getNearestOutside() const {
+            return std::min(sizeX, sizeY);
+        }
+        
+        //visit(e) for everything in the ring'th ring of cells around columns column0..column1 of the row, an item
+        //in several cells comes up once per cell. False once the ring takes in the whole grid
+        template <typename Visit>
+        bool visitRing(int ring, int column0, int column1, int r0, Visit&& visit) const {
+            int left = column0 - ring, right = column1 + ring, bottom = r0 - ring, top = r0 + ring;
+            for (int r = std::max(bottom, 0); r <= std::min(top, GRID - 1); ++r) {
+                bool bBorderRow = r == bottom || r == top;
+                for (int c = std::max(left, 0); c <= std::min(right, GRID - 1); ++c) {
+                    if (!bBorderRow && c != left && c != right) {
+                        continue;
+                    }
+                    for (int k = starts[r * GRID + c]; k < starts[r * GRID + c + 1]; ++k) {
+                        visit(items[k]);
+                    }
+                }
+            }
+            return !(left <= 0 && bottom <= 0 && right >= GRID - 1 && top >= GRID - 1);
+        }
+    };
+    
+    //an edge crossing a row's height, with the part of the winding test that doesn't depend on the texel
+    struct Crossing {
+        float ax;
+        float dy;
+        float lhs;
+        bool bUp;
+    };
+    
+    /*
+     The winding along a row of texels against curves. Each curve is split where y turns round, so every piece
+     crosses a row's height at most once, and the pieces' ends go by the segments' half-open rule, so a row
+     through a join between curves counts once.
+     */
+    class Windings {
+    private:
+        //t0..t1 of a curve, y-monotone
+        struct Piece {
+            int curve;
+            float t0, t1;
+            float y0, y1;
+        };
+        const std::vector<Quadratic>& curves;
+        std::vector<Piece> pieces{};
+        //where each piece crossing the row is, and which way it goes
+        std::vector<std::pair<double, bool>> crossings{};
+    
+    public:
+        explicit Windings(const std::vector<Quadratic>& curves) : curves(curves) {
+            for (int e = 0; e < (int)curves.size(); ++e) {
+                const Quadratic& curve = curves[e];
+                float denominator = curve.p0.y - 2.0f * curve.p1.y + curve.p2.y;
+                float turn = denominator != 0.0f ? (curve.p0.y - curve.p1.y) / denominator : 0.0f;
+                if (turn > 0.0f && turn < 1.0f) {
+                    float yTurn = evaluate(curve, turn).y;
+                    pieces.push_back({e, 0.0f, turn, curve.p0.y, yTurn});
+                    pieces.push_back({e, turn, 1.0f, yTurn, curve.p2.y});
+                }
+                else {
+                    pieces.push_back({e, 0.0f, 1.0f, curve.p0.y, curve.p2.y});
+                }
+            }
+        }
+        
+        void setRow(float py) {
+            crossings.clear();
+            for (const Piece& piece : pieces) {
+                if ((piece.y0 <= py) == (piece.y1 <= py)) {
+                    continue;
+                }
+                //y(t) = py, a t^2 + b t + c, the root that's on the piece
+                const Quadratic& curve = curves[piece.curve];
+                double a = (double)curve.p0.y - 2.0 * curve.p1.y + curve.p2.y;
+                double b = 2.0 * ((double)curve.p1.y - curve.p0.y);
+                double c = (double)curve.p0.y - py;
+                double t;
+                if (std::abs(a) < 1e-12 * (std::abs(b) + 1.0)) {
+                    t = -c / b;
+                }
+                else {
+                    double root = std::sqrt(std::max(b * b - 4.0 * a * c, 0.0));
+                    //the stable pair, no cancellation in either
+                    double qq = -0.5 * (b + std::copysign(root, b));
+                    double first = qq / a, second = qq != 0.0 ? c / qq : first;
+                    auto off = [&](double s) {
+                        return std::max(piece.t0 - s, s - piece.t1);
+                    };
+                    t = off(first) < off(second) ? first : second;
+                }
+                t = std::clamp(t, (double)piece.t0, (double)piece.t1);
+                double x = (1.0 - t) * (1.0 - t) * curve.p0.x + 2.0 * t * (1.0 - t) * curve.p1.x + t * t * curve.p2.x;
+                crossings.push_back({x, piece.y0 <= py});
+            }
+        }
+        
+        //the same as the segments': +1 upwards, -1 downwards, for whatever crosses to the right of the texel
+        int at(float px) const {
+            int winding = 0;
+            for (const auto& crossing : crossings) {
+                if (crossing.first > px) {
+                    winding += crossing.second ? 1 : -1;
+                }
+            }
+            return winding;
+        }
+    };
+    
+    static glm::vec2 evaluate(const Quadratic& curve, float t) {
+        return (1.0f - t) * (1.0f - t) * curve.p0 + 2.0f * t * (1.0f - t) * curve.p1 + t * t * curve.p2;
+    }
+    
+    //the control points' box, which holds the curve
+    static glm::vec4 boundingBox(const Quadratic& curve) {
+        glm::vec2 low = glm::min(curve.p0, glm::min(curve.p1, curve.p2)), high = glm::max(curve.p0, glm::max(curve.p1, curve.p2));
+        return glm::vec4(low.x, low.y, high.x, high.y);
+    }
+    
+    //the real roots of a t^3 + b t^2 + c t + d, a != 0
+    static int solveCubic(double a, double b, double c, double d, double* roots) {
+        b /= a;
+        c /= a;
+        d /= a;
+        //t = u - b/3 gives u^3 + p u + q
+        double p = c - b * b / 3.0;
+        double q = 2.0 * b * b * b / 27.0 - b * c / 3.0 + d;
+        double offset = -b / 3.0;
+        double discriminant = q * q / 4.0 + p * p * p / 27.0;
+        if (discriminant > 0.0) {
+            double s = std::sqrt(discriminant);
+            roots[0] = std::cbrt(-q / 2.0 + s) + std::cbrt(-q / 2.0 - s) + offset;
+            return 1;
+        }
+        if (p >= 0.0) {
+            roots[0] = offset;
+            return 1;
+        }
+        //three real ones, trigonometrically: r cos(phi - 2 pi k/3), the other two from cos(phi) and sin(phi)
+        double r = 2.0 * std::sqrt(-p / 3.0);
+        double phi = std::acos(std::clamp(3.0 * q / (2.0 * p) * std::sqrt(-3.0 / p), -1.0, 1.0)) / 3.0;
+        double cosine = std::cos(phi), sine = std::sqrt(std::max(1.0 - cosine * cosine, 0.0));
+        roots[0] = r * cosine + offset;
+        roots[1] = r * (-0.5 * cosine + 0.5 * std::sqrt(3.0) * sine) + offset;
+        roots[2] = r * (-0.5 * cosine - 0.5 * std::sqrt(3.0) * sine) + offset;
+        return 3;
+    }
+    
+    //which of the three channels an edge counts in, a bit each
+    enum Colour {
+        BLACK = 0,
+        RED = 1,
+        GREEN = 2,
+        YELLOW = 3,
+        BLUE = 4,
+        MAGENTA = 5,
+        CYAN = 6,
+        WHITE = 7
+    };
+    
+    struct ColouredCurve {
+        Quadratic curve;
+        int colour;
+    };
+    
+    //B'(t), or towards the far end where p1 sits on an end and it vanishes
+    static glm::vec2 direction(const Quadratic& curve, float t) {
+        glm::vec2 tangent = 2.0f * (1.0f - t) * (curve.p1 - curve.p0) + 2.0f * t * (curve.p2 - curve.p1);
+        if (tangent == glm::vec2(0.0f)) {
+            return curve.p2 - curve.p0;
+        }
+        return tangent;
+    }
+    
+    static void split(const Quadratic& curve, float t, Quadratic& first, Quadratic& second) {
+        glm::vec2 q0 = curve.p0 + t * (curve.p1 - curve.p0), q1 = curve.p1 + t * (curve.p2 - curve.p1);
+        glm::vec2 middle = q0 + t * (q1 - q0);
+        first = {curve.p0, q0, middle};
+        second = {middle, q1, curve.p2};
+    }
+    
+    //msdfgen's: the next of cyan, magenta, yellow along from colour, never one that's the same as banned
+    static void switchColour(int& colour, unsigned long long& seed, int banned = BLACK) {
+        int combined = colour & banned;
+        if (combined == RED || combined == GREEN || combined == BLUE) {
+            colour = combined ^ WHITE;
+            return;
+        }
+        if (colour == BLACK || colour == WHITE) {
+            static const int start[3] = {CYAN, MAGENTA, YELLOW};
+            colour = start[seed % 3];
+            seed /= 3;
+            return;
+        }
+        int shifted = colour << (1 + (seed & 1));
+        colour = (shifted | shifted >> 3) & WHITE;
+        seed >>= 1;
+    }
+    
+    /*
+     msdfgen's simple edge colouring. A contour without corners is white, every channel sees all of it. Otherwise
+     the colour changes at each corner, between two of cyan, magenta and yellow, so the edges either side of a
+     corner share just one channel and the median of the three keeps the corner. A contour with one corner (a
+     teardrop) goes colour, white, colour around from it, which takes at least three edges, so a shorter one is
+     cut into thirds first. Curves that are a point are dropped.
+     */
+    static std::vector<ColouredCurve> colourEdges(const std::vector<Quadratic>& curves, const std::vector<int>& contourEnds) {
+        //directions turning by more than about 8 degrees (or doubling back) make a corner
+        const float crossThreshold = std::sin(3.0f);
+        std::vector<ColouredCurve> coloured{};
+        unsigned long long seed = 0;
+        int begin = 0;
+        for (int end : contourEnds) {
+            std::vector<Quadratic> contour{};
+            for (int e = begin; e < end; ++e) {
+                if (!(curves[e].p0 == curves[e].p1 && curves[e].p1 == curves[e].p2)) {
+                    contour.push_back(curves[e]);
+                }
+            }
+            begin = end;
+            int n = (int)contour.size();
+            if (n == 0) {
+                continue;
+            }
+            std::vector<int> corners{};
+            glm::vec2 previous = glm::normalize(direction(contour.back(), 1.0f));
+            for (int e = 0; e < n; ++e) {
+                glm::vec2 next = glm::normalize(direction(contour[e], 0.0f));
+                if (glm::dot(previous, next) <= 0.0f || std::abs(previous.x * next.y - previous.y * next.x) > crossThreshold) {
+                    corners.push_back(e);
+                }
+                previous = glm::normalize(direction(contour[e], 1.0f));
+            }
+            if (corners.empty()) {
+                for (const Quadratic& curve : contour) {
+                    coloured.push_back({curve, WHITE});
+                }
+            }
+            else if (corners.size() == 1) {
+                int colours[3];
+                int colour = WHITE;
+                switchColour(colour, seed);
+                colours[0] = colour;
+                colours[1] = WHITE;
+                switchColour(colour, seed);
+                colours[2] = colour;
+                int corner = corners[0];
+                if (n >= 3) {
+                    for (int i = 0; i < n; ++i) {
+                        //-1, 0 or 1 for the first, middle and last third of the way round
+                        int third = (int)(3 + 2.875 * i / (n - 1) - 1.4375 + 0.5) - 3;
+                        coloured.push_back({contour[(corner + i) % n], colours[1 + third]});
+                    }
+                }
+                else {
+                    std::vector<Quadratic> parts{};
+                    for (int i = 0; i < n; ++i) {
+                        Quadratic first, rest, second, last;
+                        split(contour[(corner + i) % n], 1.0f / 3.0f, first, rest);
+                        split(rest, 0.5f, second, last);
+                        parts.push_back(first);
+                        parts.push_back(second);
+                        parts.push_back(last);
+                    }
+                    for (int i = 0; i < (int)parts.size(); ++i) {
+                        coloured.push_back({parts[i], colours[i * 3 / (int)parts.size()]});
+                    }
+                }
+            }
+            else {
+                int nCorners = (int)corners.size();
+                int spline = 0;
+                int colour = WHITE;
+                switchColour(colour, seed);
+                int initialColour = colour;
+                for (int i = 0; i < n; ++i) {
+                    int e = (corners[0] + i) % n;
+                    if (spline + 1 < nCorners && corners[spline + 1] == e) {
+                        ++spline;
+                        //the last stretch mustn't match the first, they meet at corners[0]
+                        switchColour(colour, seed, spline == nCorners - 1 ? initialColour : BLACK);
+                    }
+                    coloured.push_back({contour[e], colour});
+                }
+            }
+        }
+        return coloured;
+    }
+    
+    /*
+     Signed distance to the curve, negative inside, measured to the tangent line instead past whichever end t is
+     at. Inside is decided by the side of the curve the point's on, bInsideLeft of its direction or not.
+     */
+    static double pseudoDistance(glm::vec2 point, const Quadratic& curve, double t, bool bInsideLeft) {
+        glm::dvec2 tangent = glm::dvec2(direction(curve, (float)t));
+        glm::dvec2 foot = t <= 0.0 ? glm::dvec2(curve.p0) : t >= 1.0 ? glm::dvec2(curve.p2) : glm::dvec2(evaluate(curve, (float)t));
+        glm::dvec2 offset = glm::dvec2(point) - foot;
+        double distance = glm::length(offset);
+        if (t <= 0.0 || t >= 1.0) {
+            glm::dvec2 unit = tangent / glm::length(tangent);
+            double along = glm::dot(offset, unit);
+            if (t <= 0.0 ? along < 0.0 : along > 0.0) {
+                distance = std::abs(unit.x * offset.y - unit.y * offset.x);
+            }
+        }
+        bool bLeft = tangent.x * offset.y - tangent.y * offset.x > 0.0;
+        return bLeft == bInsideLeft ? -distance : distance;
+    }
+
+public:
+    
+    struct Nearest {
+        double t;
+        double distanceSquared;
+    };
+    
+    /*
+     Where on the curve is nearest p. With B(t) = p0 + 2tA + t^2 B, (B(t) - p).B'(t) = 0 is the cubic
+     (B.B) t^3 + 3(A.B) t^2 + (2A.A + d.B) t + d.A with d = p0 - p; the nearest point is one of its roots in
+     [0, 1] or an end. Doubles, since the coefficients go to the fourth power of font units.
+     */
+    static Nearest nearestOn(glm::vec2 point, const Quadratic& curve) {
+        glm::dvec2 p0 = glm::dvec2(curve.p0), A = glm::dvec2(curve.p1) - p0, B = glm::dvec2(curve.p2) - 2.0 * glm::dvec2(curve.p1) + p0;
+        glm::dvec2 d = p0 - glm::dvec2(point);
+        auto at = [&](double t) {
+            //the ends exactly, so two curves meeting at a point measure the same to it
+            glm::dvec2 offset = t <= 0.0 ? d : t >= 1.0 ? glm::dvec2(curve.p2) - glm::dvec2(point) : d + 2.0 * t * A + t * t * B;
+            return glm::dot(offset, offset);
+        };
+        Nearest nearest{0.0, at(0.0)};
+        auto consider = [&](double t) {
+            t = std::clamp(t, 0.0, 1.0);
+            double distanceSquared = at(t);
+            if (distanceSquared < nearest.distanceSquared) {
+                nearest = {t, distanceSquared};
+            }
+        };
+        consider(1.0);
+        double a = glm::dot(B, B), AA = glm::dot(A, A);
+        double roots[3];
+        int nRoots = 0;
+        if (a > 1e-12 * AA) {
+            nRoots = solveCubic(a, 3.0 * glm::dot(A, B), 2.0 * AA + glm::dot(d, B), glm::dot(d, A), roots);
+        }
+        else if (AA > 0.0) {
+            //p1 halfway along, a straight line
+            roots[nRoots++] = -glm::dot(d, A) / (2.0 * AA);
+        }
+        for (int k = 0; k < nRoots; ++k) {
+            consider(roots[k]);
+        }
+        return nearest;
+    }
+    
+    static double distanceSquared(glm::vec2 point, const Quadratic& curve) {
+        return nearestOn(point, curve).distanceSquared;
+    }
+    
+    //the original loop over the texels, the scalar baseline for the benchmark
+    static void computeReference(const std::vector<glm::vec4>& edges, float* out) {
+        Frame frame(edges);
+        for (int i = 0; i < SIZE; ++i) {
+            for (int j = 0; j < SIZE; ++j) {
+                out[j * SIZE + i] = signedDistance(glm::vec2(frame.x(i), frame.y(j)), edges);
+            }
+        }
+    }
+    
+    static void compute(const std::vector<glm::vec4>& edges, float* out) {
+        Frame frame(edges);
+        //the segments to measure to, as arrays. A zero length one is skipped, it's NaN in signedDistance and
+        //drops out of the minimum there too (and can't cross a row)
+        std::vector<float> ax{}, ay{}, abx{}, aby{}, length2{};
+        std::vector<glm::vec4> boxes{};
+        for (const glm::vec4& edge : edges) {
+            glm::vec2 ab = glm::vec2(edge.z, edge.w) - glm::vec2(edge.x, edge.y);
+            float abab = glm::dot(ab, ab);
+            if (!(abab > 0.0f)) {
+                continue;
+            }
+            ax.push_back(edge.x);
+            ay.push_back(edge.y);
+            abx.push_back(ab.x);
+            aby.push_back(ab.y);
+            length2.push_back(abab);
+            boxes.push_back(glm::vec4(std::min(edge.x, edge.z), std::min(edge.y, edge.w), std::max(edge.x, edge.z), std::max(edge.y, edge.w)));
+        }
+        int nEdges = (int)ax.size();
+        Buckets buckets(frame, boxes);
+        float nearestOutside = buckets.getNearestOutside();
+        std::vector<int> lastVisit(nEdges, -1);
+        int visit = 0;
+        float xs[SIZE];
+        for (int i = 0; i < SIZE; ++i) {
+            xs[i] = frame.x(i);
+        }
+        std::vector<Crossing> crossings{};
+        for (int j = 0; j < SIZE; ++j) {
+            float py = frame.y(j);
+            crossings.clear();
+            for (const glm::vec4& edge : edges) {
+                if ((edge.y <= py) != (edge.w <= py)) {
+                    crossings.push_back({edge.x, edge.w - edge.y, (edge.z - edge.x) * (py - edge.y), edge.y <= py});
+                }
+            }
+            int row = buckets.row(py);
+            simd::forEach(SIZE, [&](int i, auto lane) {
+                constexpr int nLanes = simd::lanes<decltype(lane)>();
+                auto px = simd::load(xs + i, lane);
+                auto zero = simd::set(0.0f, lane), one = simd::set(1.0f, lane);
+                //winding: +1 crossing upwards with the texel left of the edge, -1 downwards with it to the right
+                auto winding = zero;
+                for (const Crossing& crossing : crossings) {
+                    auto lhs = simd::set(crossing.lhs, lane);
+                    auto rhs = simd::mul(simd::sub(px, simd::set(crossing.ax, lane)), simd::set(crossing.dy, lane));
+                    winding = crossing.bUp ? simd::add(winding, simd::select(simd::less(rhs, lhs), one, zero))
+                                           : simd::sub(winding, simd::select(simd::less(lhs, rhs), one, zero));
+                }
+                //squared distance to the nearest segment, a ring of buckets at a time
+                auto nearest = simd::set(std::numeric_limits<float>::infinity(), lane);
+                ++visit;
+                int column0 = buckets.column(xs[i]), column1 = buckets.column(xs[i + nLanes - 1]);
+                for (int ring = 0; nEdges > 0; ++ring) {
+                    bool bMore = buckets.visitRing(ring, column0, column1, row, [&](int e) {
+                        if (lastVisit[e] == visit) {
+                            return;
+                        }
+                        lastVisit[e] = visit;
+                        auto eax = simd::set(ax[e], lane), eay = simd::set(ay[e], lane);
+                        auto eabx = simd::set(abx[e], lane), eaby = simd::set(aby[e], lane);
+                        auto apx = simd::sub(px, eax);
+                        auto apy = simd::set(py - ay[e], lane);
+                        auto t = simd::div(simd::add(simd::mul(apx, eabx), simd::mul(apy, eaby)), simd::set(length2[e], lane));
+                        t = simd::min(simd::max(t, zero), one);
+                        auto dx = simd::sub(simd::add(eax, simd::mul(t, eabx)), px);
+                        auto dy = simd::sub(simd::add(eay, simd::mul(t, eaby)), simd::set(py, lane));
+                        nearest = simd::min(nearest, simd::add(simd::mul(dx, dx), simd::mul(dy, dy)));
+                    });
+                    if (!bMore) {
+                        break;
+                    }
+                    //anything in a cell not visited yet is at least ring cells away
+                    float settled[simd::width > 1 ? simd::width : 1];
+                    simd::store(settled, nearest);
+                    float bound = ring * nearestOutside;
+                    if (*std::max_element(settled, settled + nLanes) <= bound * bound) {
+                        break;
+                    }
+                }
+                auto distance = nEdges > 0 ? simd::sqrt(nearest) : simd::set(std::numeric_limits<float>::max(), lane);
+                auto inside = simd::bitOr(simd::less(winding, zero), simd::less(zero, winding));
+                simd::store(out + j * SIZE + i, simd::select(inside, simd::mul(distance, simd::set(-1.0f, lane)), distance));
+            });
+        }
+    }
+    
+    /*
+     The same field measured against the quadratics the font actually has rather than GRANULARITY segments for
+     each: about fifty times fewer things to measure to, each dearer (a cubic rather than a projection), and the
+     distance is to the curve rather than to its chords. A texel at a time, the roots don't vectorize usefully,
+     but BLOCK of them share the walk through the buckets. The winding is exact too, see Windings.
+     */
+    static void computeQuadratic(const std::vector<Quadratic>& curves, float* out) {
+        static_assert(SIZE % BLOCK == 0, "rows split into whole blocks");
+        Frame frame(curves);
+        std::vector<int> measured{};
+        std::vector<glm::vec4> boxes{};
+        for (int e = 0; e < (int)curves.size(); ++e) {
+            const Quadratic& curve = curves[e];
+            if (curve.p0 == curve.p1 && curve.p1 == curve.p2) {
+                continue;
+            }
+            measured.push_back(e);
+            boxes.push_back(boundingBox(curve));
+        }
+        int nMeasured = (int)measured.size();
+        Buckets buckets(frame, boxes);
+        float nearestOutside = buckets.getNearestOutside();
+        std::vector<int> lastVisit(nMeasured, -1);
+        int visit = 0;
+        Windings windings(curves);
+        for (int j = 0; j < SIZE; ++j) {
+            float py = frame.y(j);
+            windings.setRow(py);
+            int row = buckets.row(py);
+            int closest = -1;
+            //BLOCK texels share a walk of the rings, each has its own nearest
+            for (int i = 0; i < SIZE; i += BLOCK) {
+                double nearest[BLOCK];
+                ++visit;
+                for (int k = 0; k < BLOCK; ++k) {
+                    //start from whatever was nearest the texel before, then most of the rest go on their boxes
+                    nearest[k] = closest >= 0 ? distanceSquared(glm::vec2(frame.x(i + k), py), curves[measured[closest]]) : std::numeric_limits<double>::infinity();
+                }
+                if (closest >= 0) {
+                    lastVisit[closest] = visit;
+                }
+                for (int ring = 0; nMeasured > 0; ++ring) {
+                    bool bMore = buckets.visitRing(ring, buckets.column(frame.x(i)), buckets.column(frame.x(i + BLOCK - 1)), row, [&](int e) {
+                        if (lastVisit[e] == visit) {
+                            return;
+                        }
+                        lastVisit[e] = visit;
+                        for (int k = 0; k < BLOCK; ++k) {
+                            float px = frame.x(i + k);
+                            //the curve's inside its box, no closer than that
+                            float outsideX = std::max({boxes[e].x - px, px - boxes[e].z, 0.0f});
+                            float outsideY = std::max({boxes[e].y - py, py - boxes[e].w, 0.0f});
+                            if ((double)outsideX * outsideX + (double)outsideY * outsideY >= nearest[k]) {
+                                continue;
+                            }
+                            double d = distanceSquared(glm::vec2(px, py), curves[measured[e]]);
+                            if (d < nearest[k]) {
+                                nearest[k] = d;
+                                closest = e;
+                            }
+                        }
+                    });
+                    double bound = ring * nearestOutside;
+                    if (!bMore || *std::max_element(nearest, nearest + BLOCK) <= bound * bound) {
+                        break;
+                    }
+                }
+                for (int k = 0; k < BLOCK; ++k) {
+                    float distance = nMeasured > 0 ? (float)std::sqrt(nearest[k]) : std::numeric_limits<float>::max();
+                    out[j * SIZE + i + k] = windings.at(frame.x(i + k)) != 0 ? -distance : distance;
+                }
+            }
+        }
+    }
+    
+    /*
+     Chlumsky's multi-channel field, size x size RGB texels over the curves' extent (size from MSDF_MIN_SIZE to
+     MSDF_MAX_SIZE), measured at the texels' centres, for the median of three in glyphmsdffs.glsl. The edges are coloured (colourEdges, the
+     contours end at contourEnds) and each channel is the pseudo-distance to the nearest edge of its colour,
+     the nearest by true distance with ties at a shared end going to the edge the texel is more square on to.
+     Past an edge's end the pseudo-distance carries on along its tangent, so at a corner two channels keep going
+     straight and their median has the corner where a single channel rounds it off, which is what lets the
+     field be this much smaller. Where the median still comes out on the wrong side of the outline (the exact
+     winding says which is right) the texel gets the true distance in all three.
+     
+     A channel is 0.5 - d / (2 range) in a byte: 0.5 on the outline, more inside, saturating range em units
+     either side. range is MSDF_RANGE texels and comes back for the shader to decode with.
+     */
+    static float computeMultichannel(const std::vector<Quadratic>& curves, const std::vector<int>& contourEnds, int size, unsigned char* out) {
+        Frame frame(curves, size, 0.5f);
+        std::vector<ColouredCurve> edges = colourEdges(curves, contourEnds);
+        float range = MSDF_RANGE * std::max(frame.cellSizeX, frame.cellSizeY);
+        if (edges.empty() || !(range > 0.0f)) {
+            std::fill(out, out + size * size * 3, (unsigned char)0);
+            return 1.0f;
+        }
+        //TrueType's outer contours go clockwise and its holes the other way, so inside is on the right of every
+        //edge; a font drawn the other way round has it on the left, and then its area comes out positive
+        double area = 0.0;
+        for (const ColouredCurve& edge : edges) {
+            const Quadratic& curve = edge.curve;
+            area += (double)curve.p0.x * curve.p1.y - (double)curve.p1.x * curve.p0.y + (double)curve.p1.x * curve.p2.y - (double)curve.p2.x * curve.p1.y;
+        }
+        bool bInsideLeft = area > 0.0;
+        std::vector<glm::vec4> boxes{};
+        bool bHasChannel[3] = {false, false, false};
+        for (const ColouredCurve& edge : edges) {
+            boxes.push_back(boundingBox(edge.curve));
+            for (int c = 0; c < 3; ++c) {
+                bHasChannel[c] = bHasChannel[c] || (edge.colour >> c & 1);
+            }
+        }
+        Buckets buckets(frame, boxes);
+        float nearestOutside = buckets.getNearestOutside();
+        std::vector<int> lastVisit(edges.size(), -1);
+        int visit = 0;
+        Windings windings(curves);
+        struct Best {
+            double distanceSquared;
+            //|cos| between the edge's direction and the way to the texel, smaller is more square on
+            double skew;
+            int edge;
+            double t;
+        };
+        for (int j = 0; j < size; ++j) {
+            float py = frame.y(j);
+            windings.setRow(py);
+            int row = buckets.row(py);
+            for (int i = 0; i < size; ++i) {
+                glm::vec2 p = glm::vec2(frame.x(i), py);
+                Best best[3];
+                for (Best& channel : best) {
+                    channel = {std::numeric_limits<double>::infinity(), 1.0, -1, 0.0};
+                }
+                ++visit;
+                int column = buckets.column(p.x);
+                for (int ring = 0;; ++ring) {
+                    bool bMore = buckets.visitRing(ring, column, column, row, [&](int e) {
+                        if (lastVisit[e] == visit) {
+                            return;
+                        }
+                        lastVisit[e] = visit;
+                        int colour = edges[e].colour;
+                        float outsideX = std::max({boxes[e].x - p.x, p.x - boxes[e].z, 0.0f});
+                        float outsideY = std::max({boxes[e].y - p.y, p.y - boxes[e].w, 0.0f});
+                        double boxDistanceSquared = (double)outsideX * outsideX + (double)outsideY * outsideY;
+                        bool bCouldWin = false;
+                        for (int c = 0; c < 3; ++c) {
+                            bCouldWin = bCouldWin || ((colour >> c & 1) && boxDistanceSquared <= best[c].distanceSquared);
+                        }
+                        if (!bCouldWin) {
+                            return;
+                        }
+                        Nearest nearest = nearestOn(p, edges[e].curve);
+                        glm::dvec2 tangent = glm::dvec2(direction(edges[e].curve, (float)nearest.t));
+                        glm::dvec2 foot = nearest.t <= 0.0 ? glm::dvec2(edges[e].curve.p0) : nearest.t >= 1.0 ? glm::dvec2(edges[e].curve.p2) : glm::dvec2(evaluate(edges[e].curve, (float)nearest.t));
+                        glm::dvec2 offset = glm::dvec2(p) - foot;
+                        double offsetLength = glm::length(offset);
+                        double skew = offsetLength > 0.0 ? std::abs(glm::dot(tangent, offset)) / (glm::length(tangent) * offsetLength) : 0.0;
+                        for (int c = 0; c < 3; ++c) {
+                            if (!(colour >> c & 1)) {
+                                continue;
+                            }
+                            if (nearest.distanceSquared < best[c].distanceSquared || (nearest.distanceSquared == best[c].distanceSquared && skew < best[c].skew)) {
+                                best[c] = {nearest.distanceSquared, skew, e, nearest.t};
+                            }
+                        }
+                    });
+                    if (!bMore) {
+                        break;
+                    }
+                    double bound = ring * nearestOutside;
+                    bool bSettled = true;
+                    for (int c = 0; c < 3; ++c) {
+                        bSettled = bSettled && (!bHasChannel[c] || best[c].distanceSquared <= bound * bound);
+                    }
+                    if (bSettled) {
+                        break;
+                    }
+                }
+                double trueDistanceSquared = std::min({best[0].distanceSquared, best[1].distanceSquared, best[2].distanceSquared});
+                double trueDistance = windings.at(p.x) != 0 ? -std::sqrt(trueDistanceSquared) : std::sqrt(trueDistanceSquared);
+                double channels[3];
+                for (int c = 0; c < 3; ++c) {
+                    channels[c] = best[c].edge >= 0 ? pseudoDistance(p, edges[best[c].edge].curve, best[c].t, bInsideLeft) : trueDistance;
+                }
+                double median = std::max(std::min(channels[0], channels[1]), std::min(std::max(channels[0], channels[1]), channels[2]));
+                if ((median < 0.0) != (trueDistance < 0.0)) {
+                    channels[0] = channels[1] = channels[2] = trueDistance;
+                }
+                for (int c = 0; c < 3; ++c) {
+                    double encoded = std::clamp(0.5 - channels[c] / (2.0 * range), 0.0, 1.0);
+                    out[(j * size + i) * 3 + c] = (unsigned char)std::lround(encoded * 255.0);
+                }
+            }
+        }
+        return range;
+    }
+};
+
+#endif /* glyphsdf_h */
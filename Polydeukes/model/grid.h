@@ -66,9 +66,13 @@ public:
 
     }
     
-    void render(ShaderProgram shaderProgram) override {
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
+    unsigned int getVAO() const override {
+        return VAO;
+    }
+    
+    void render(ShaderProgram& shaderProgram) override {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
         glBindVertexArray(VAO);
         glDrawArrays(GL_LINES, 0, vertices.size() / 3);
     }
@@ -0,0 +1,217 @@
+//
+//  instancedbatch.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef instancedbatch_h
+#define instancedbatch_h
+
+#include "shape.h"
+#include "ShaderProgram.h"
+
+#include <glad/glad.h>
+#include <glm.hpp>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+/*
+ Clones of a Cube/Square/Sphere already share their factory's VAO, so the only thing that differs per clone is
+ the model matrix and the colour. An InstancedBatch collects clones of one primitive and draws them all with a
+ single instanced call, reading model/colour from a per-instance buffer (instancedshapevs.glsl) instead of uniforms.
+ 
+ The member shapes stay ordinary shapes: callers keep moving and recolouring them as before (chip8 flips pixel
+ colours, the dragger translates). Each render we diff the shapes against what was last uploaded and only
+ re-upload the dirty span, so a frame where nothing moved costs no buffer traffic.
+ */
+class InstancedBatch : public Shape {
+private:
+    struct InstanceData {
+        glm::mat4 model;
+        glm::vec4 colour;
+    };
+    
+    //mat4 takes locations 3-6, after position/normal/texture in the shared vertex layout
+    static constexpr unsigned int MODEL_LOCATION = 3;
+    static constexpr unsigned int COLOUR_LOCATION = 7;
+    
+    std::shared_ptr<Shape> prototype;
+    std::vector<std::shared_ptr<Shape>> instances{};
+    std::vector<InstanceData> instanceData{};
+    unsigned int instanceVBO = 0;
+    size_t bufferCapacity = 0;
+    size_t dirtyBegin = 0;
+    size_t dirtyEnd = 0;
+    bool bInitialized = false;
+    
+    InstancedBatch(InstancedBatch& that) : Shape(that), prototype(that.prototype), instances(that.instances), instanceData(that.instanceData) {
+        dirtyBegin = 0;
+        dirtyEnd = instanceData.size();
+    }
+    
+    void init() {
+        glGenBuffers(1, &instanceVBO);
+        bInitialized = true;
+    }
+    
+    void markDirty(size_t index) {
+        if (dirtyBegin == dirtyEnd) {
+            dirtyBegin = index;
+            dirtyEnd = index + 1;
+            return;
+        }
+        dirtyBegin = std::min(dirtyBegin, index);
+        dirtyEnd = std::max(dirtyEnd, index + 1);
+    }
+    
+    void syncInstances() {
+        for (size_t i = 0; i < instances.size(); ++i) {
+            InstanceData current{instances[i]->getModellingTransform(), glm::vec4(instances[i]->getColour(), 1.f)};
+            if (std::memcmp(&current, &instanceData[i], sizeof(InstanceData)) != 0) {
+                instanceData[i] = current;
+                markDirty(i);
+            }
+        }
+    }
+    
+    void upload() {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (instanceData.size() > bufferCapacity) {
+            //grow geometrically so spawning one more clone doesn't reallocate every time
+            bufferCapacity = std::max(instanceData.size(), bufferCapacity * 2);
+            glBufferData(GL_ARRAY_BUFFER, bufferCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instanceData.size() * sizeof(InstanceData), instanceData.data());
+        }
+        else if (dirtyBegin != dirtyEnd) {
+            glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin * sizeof(InstanceData), (dirtyEnd - dirtyBegin) * sizeof(InstanceData), instanceData.data() + dirtyBegin);
+        }
+        dirtyBegin = dirtyEnd = 0;
+    }
+    
+    /*
+     The instance attributes go on the prototype's VAO for the duration of the draw and are switched off again after,
+     so the non-instanced clones sharing that VAO (and any other batch of the same primitive) are unaffected.
+     */
+    void enableInstanceAttributes() {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int column = 0; column < 4; ++column) {
+            glVertexAttribPointer(MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(MODEL_LOCATION + column);
+            glVertexAttribDivisor(MODEL_LOCATION + column, 1);
+        }
+        glVertexAttribPointer(COLOUR_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, colour)));
+        glEnableVertexAttribArray(COLOUR_LOCATION);
+        glVertexAttribDivisor(COLOUR_LOCATION, 1);
+    }
+    
+    void disableInstanceAttributes() {
+        for (unsigned int location = MODEL_LOCATION; location <= COLOUR_LOCATION; ++location) {
+            glVertexAttribDivisor(location, 0);
+            glDisableVertexAttribArray(location);
+        }
+    }
+
+public:
+    
+    explicit InstancedBatch(std::shared_ptr<Shape> prototype) : prototype(prototype) {}
+    
+    virtual ~InstancedBatch() {
+        if (bInitialized) {
+            glDeleteBuffers(1, &instanceVBO);
+        }
+    }
+    
+    /*
+     Only clones of the prototype's primitive can join, i.e. shapes drawing from the same VAO.
+     */
+    bool add(std::shared_ptr<Shape> instance) {
+        if (instance == nullptr || instance->getVAO() != prototype->getVAO()) {
+            std::cout << "InstancedBatch: shape does not share the batch's VAO" << std::endl;
+            return false;
+        }
+        instances.push_back(instance);
+        instanceData.push_back({instance->getModellingTransform(), glm::vec4(instance->getColour(), 1.f)});
+        markDirty(instanceData.size() - 1);
+        return true;
+    }
+    
+    void remove(std::shared_ptr<Shape> instance) {
+        for (size_t i = 0; i < instances.size(); ++i) {
+            if (instances[i] == instance) {
+                //swap with the last instance so only one slot needs re-uploading
+                instances[i] = instances.back();
+                instanceData[i] = instanceData.back();
+                instances.pop_back();
+                instanceData.pop_back();
+                if (i < instances.size()) {
+                    markDirty(i);
+                }
+                dirtyEnd = std::min(dirtyEnd, instanceData.size());
+                dirtyBegin = std::min(dirtyBegin, dirtyEnd);
+                return;
+            }
+        }
+    }
+    
+    const std::vector<std::shared_ptr<Shape>>& getInstances() const {
+        return instances;
+    }
+    
+    size_t size() const {
+        return instances.size();
+    }
+    
+    unsigned int getVAO() const override {
+        return prototype->getVAO();
+    }
+    
+    unsigned int getTexture() const override {
+        return prototype->getTexture();
+    }
+    
+    void render(ShaderProgram& shaderProgram) override {
+        if (instances.empty()) {
+            return;
+        }
+        if (!bInitialized) {
+            init();
+        }
+        syncInstances();
+        upload();
+        glBindVertexArray(prototype->getVAO());
+        enableInstanceAttributes();
+        prototype->renderInstanced(shaderProgram, (int)instances.size());
+        disableInstanceAttributes();
+    }
+    
+    //the id shader doesn't read the instance attributes, so the picker gets the members one at a time
+    void renderID(ShaderProgram& shaderProgram) override {
+        for (auto& instance : instances) {
+            instance->render(shaderProgram);
+        }
+    }
+    
+    std::vector<glm::vec3> getAABB() override {
+        std::vector<glm::vec3> aabb{};
+        for (auto& instance : instances) {
+            aabb = Shape::mergeAABB(aabb, instance->getAABB());
+        }
+        if (aabb.size() < 2) {
+            return std::vector<glm::vec3>({glm::vec3(0.0f,0.0f,0.0f)});
+        }
+        return aabb;
+    }
+    
+    std::shared_ptr<Shape> clone() override {
+        auto retval = std::shared_ptr<InstancedBatch>(new InstancedBatch(*this));
+        retval->referenceToThis = retval;
+        return retval;
+    }
+
+};
+
+#endif /* instancedbatch_h */
@@ -10,13 +10,56 @@
 
 #include <glm.hpp>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
 
+#include "bvh.h"
+#include "vector.h"
+
+/*
+ Vertex data is kept in model space and never touched after construction, so clones (and every cube off the
+ factory) share one copy. World space positions are only needed for picking and AABBs, so rather than
+ transforming every vertex each time a shape moves we remember the transform and rebuild the world space
+ cache the next time somebody actually asks for it.
+ 
+ Picking works in model space too: the ray is taken into model space and walked down a triangle BVH that's
+ built the first time the geometry is picked (or warmed up at load) and then shared like the vertices.
+ */
 class Mesh {
   
 private:
+    struct VertexData {
+        std::vector<glm::vec3> positions{};
+        //empty for meshes built from indexed vertices
+        std::vector<glm::vec3> normals{};
+        std::vector<glm::vec2> textures{};
+        //model space bounds, only meaningful when there are positions
+        glm::vec3 localMin = glm::vec3(0.0f);
+        glm::vec3 localMax = glm::vec3(0.0f);
+        //over the triangles (positions taken three at a time), built at most once
+        mutable std::once_flag bvhBuilt;
+        mutable BVH bvh;
+    };
+    
+    std::shared_ptr<const VertexData> modelSpace = std::make_shared<const VertexData>();
+    glm::mat4 transform = glm::mat4(1.0f);
+    //world space cache, rebuilt lazily
     std::vector<glm::vec3> positions{};
-    std::vector<glm::vec3> normals{};
-    std::vector<glm::vec2> textures{};
+    bool bDirty = true;
+    //bumped whenever the transform changes so anything derived from it (world AABB) knows to recompute
+    unsigned long version = 0;
+    
+    void setVertexData(const std::shared_ptr<VertexData>& vertexData) {
+        if (!vertexData->positions.empty()) {
+            vertexData->localMin = vertexData->localMax = vertexData->positions[0];
+            for (auto& position : vertexData->positions) {
+                vertexData->localMin = glm::min(vertexData->localMin, position);
+                vertexData->localMax = glm::max(vertexData->localMax, position);
+            }
+        }
+        modelSpace = vertexData;
+    }
     
 public:
     
@@ -25,40 +68,140 @@ public:
     }
     
     Mesh(float* data, int size) {
+        auto vertexData = std::make_shared<VertexData>();
+        vertexData->positions.reserve(size / 8);
+        vertexData->normals.reserve(size / 8);
+        vertexData->textures.reserve(size / 8);
         for (int i = 0; i < size; i += 8) {
             glm::vec3 position = glm::vec3(data[i], data[i+1], data[i+2]);
             glm::vec3 normal = glm::vec3(data[i+3], data[i+4], data[i+5]);
             glm::vec2 texture_coords = glm::vec2(data[i+6], data[i+7]);
-            positions.push_back(position);
-            normals.push_back(normal);
-            textures.push_back(texture_coords);
+            vertexData->positions.push_back(position);
+            vertexData->normals.push_back(normal);
+            vertexData->textures.push_back(texture_coords);
         }
+        setVertexData(vertexData);
     }
     
-    Mesh(const Mesh& mesh) {
-        for (auto vec3 : mesh.positions) {
-            positions.push_back(vec3);
-        }
-        for (auto vec3 : mesh.normals) {
-            normals.push_back(vec3);
-        }
-        for (auto vec2 : mesh.textures) {
-            textures.push_back(vec2);
+    /*
+     Indexed triangles over interleaved vertices (position, normal, uv: 8 floats), as loaded from an OBJ. The
+     picking and the AABBs walk triangles three vertices at a time, so the positions get expanded back out here.
+     Only the positions: the GPU draws from the indexed buffers, and nothing on this side reads normals or uvs,
+     which for a big scan would be 60 bytes a triangle sitting there.
+     */
+    Mesh(const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
+        auto vertexData = std::make_shared<VertexData>();
+        vertexData->positions.reserve(indices.size());
+        for (unsigned int index : indices) {
+            const float* vertex = &vertices[8 * (size_t)index];
+            vertexData->positions.push_back(glm::vec3(vertex[0], vertex[1], vertex[2]));
         }
+        setVertexData(vertexData);
+    }
+    
+    //shares the model space data, the world space cache is rebuilt on demand
+    Mesh(const Mesh& mesh) : modelSpace(mesh.modelSpace), transform(mesh.transform), version(mesh.version + 1) {}
+    
+    Mesh& operator=(const Mesh& mesh) {
+        modelSpace = mesh.modelSpace;
+        transform = mesh.transform;
+        positions.clear();
+        bDirty = true;
+        version = std::max(version, mesh.version) + 1;
+        return *this;
     }
     
-    std::vector<glm::vec3> getPosition() {
+    const std::vector<glm::vec3>& getPosition() {
+        if (bDirty) {
+            const std::vector<glm::vec3>& source = modelSpace->positions;
+            positions.resize(source.size());
+            for (size_t i = 0; i < source.size(); ++i) {
+                glm::vec4 tmp = transform * glm::vec4(source[i].x, source[i].y, source[i].z, 1.0f);
+                positions[i] = glm::vec3(tmp.x, tmp.y, tmp.z);
+            }
+            bDirty = false;
+        }
         return positions;
     }
     
-    void updatePosition(glm::mat4& transform) {
-        std::vector<glm::vec3> newPositions{};
-        for (auto pos : positions) {
-            glm::vec4 tmp = glm::vec4(pos.x,pos.y,pos.z,1.0f);
-            tmp = transform * tmp;
-            newPositions.push_back(glm::vec3(tmp.x,tmp.y,tmp.z));
+    const std::vector<glm::vec3>& getModelSpacePosition() const {
+        return modelSpace->positions;
+    }
+    
+    size_t size() const {
+        return modelSpace->positions.size();
+    }
+    
+    glm::vec3 getLocalMin() const {
+        return modelSpace->localMin;
+    }
+    
+    glm::vec3 getLocalMax() const {
+        return modelSpace->localMax;
+    }
+    
+    size_t getTriangleCount() const {
+        return modelSpace->positions.size() / 3;
+    }
+    
+    const BVH& getBVH() const {
+        const VertexData& data = *modelSpace;
+        std::call_once(data.bvhBuilt, [&data] {
+            std::vector<AABB> boxes(data.positions.size() / 3);
+            for (size_t i = 0; i < boxes.size(); ++i) {
+                boxes[i] = AABB(data.positions[3*i], data.positions[3*i]);
+                boxes[i].grow(data.positions[3*i + 1]);
+                boxes[i].grow(data.positions[3*i + 2]);
+            }
+            data.bvh.build(boxes);
+        });
+        return data.bvh;
+    }
+    
+    /*
+     Nearest triangle hit by a model space ray closer than hit.t. Fills in hit (t, model space position and the
+     triangle index) and returns true if there is one.
+     */
+    bool intersect(const Ray& ray, RayHit& hit) const {
+        const std::vector<glm::vec3>& triangles = modelSpace->positions;
+        float tMax = hit.t;
+        int nearest = -1;
+        getBVH().intersect(ray, tMax, [&](int triangle, float& tMax) {
+            float t;
+            if (vector::rayTriangleIntersection(ray, triangles[3*triangle], triangles[3*triangle + 1], triangles[3*triangle + 2], tMax, t)) {
+                tMax = t;
+                nearest = triangle;
+                return true;
+            }
+            return false;
+        });
+        if (nearest < 0) {
+            return false;
         }
-        positions = newPositions;
+        hit.t = tMax;
+        hit.position = ray.origin + ray.direction * tMax;
+        hit.primitive = nearest;
+        return true;
+    }
+    
+    unsigned long getVersion() const {
+        return version;
+    }
+    
+    glm::mat4 getTransform() const {
+        return transform;
+    }
+    
+    //model space to world space, Shape keeps this equal to its modelling transform
+    void setTransform(const glm::mat4& transform) {
+        this->transform = transform;
+        bDirty = true;
+        ++version;
+    }
+    
+    //applies a further transform on top of the current one
+    void updatePosition(const glm::mat4& transform) {
+        setTransform(transform * this->transform);
     }
     
 };
@@ -0,0 +1,148 @@
+//
+//  meshlet.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef meshlet_h
+#define meshlet_h
+
+#include <glm.hpp>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "aabb.h"
+#include "bvh.h"
+#include "frustum.h"
+#include "meshindexer.h"
+
+/*
+ A small cluster of triangles, a run of the index buffer, with a bounding sphere for the frustum.
+ 
+ No normal cone for backface culling: nothing in this renderer culls back faces (GL_CULL_FACE is never on and
+ OBJ meshes draw both sides as wireframe), so back facing clusters are part of the picture and the picker's.
+ */
+struct Meshlet {
+    unsigned int firstIndex = 0;
+    unsigned int indexCount = 0;
+    glm::vec3 centre = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+/*
+ Meshlets over a mesh plus a BVH over them so a frame only tests the clusters near the frustum. Built once at
+ load and shared by every clone of the shape, like the mesh's triangle BVH.
+ */
+class MeshletSet {
+public:
+    
+    static constexpr unsigned int MAX_VERTICES = 64;
+    static constexpr unsigned int MAX_TRIANGLES = 124;
+
+private:
+    
+    std::vector<Meshlet> meshlets{};
+    BVH bvh{};
+    
+    static glm::vec3 vertexPosition(const std::vector<float>& vertices, unsigned int index) {
+        const float* vertex = &vertices[MeshIndexer::FLOATS_PER_VERTEX * (size_t)index];
+        return glm::vec3(vertex[0], vertex[1], vertex[2]);
+    }
+    
+    static void computeBounds(const std::vector<float>& vertices, const std::vector<unsigned int>& used, Meshlet& meshlet) {
+        AABB box = AABB::empty();
+        for (unsigned int vertex : used) {
+            box.grow(vertexPosition(vertices, vertex));
+        }
+        meshlet.centre = box.centroid();
+        float radius = 0.0f;
+        for (unsigned int vertex : used) {
+            radius = std::max(radius, glm::length(vertexPosition(vertices, vertex) - meshlet.centre));
+        }
+        meshlet.radius = radius;
+    }
+
+public:
+    
+    MeshletSet() = default;
+    
+    /*
+     Cuts indexCount indices from firstIndex into meshlets of up to MAX_VERTICES vertices and MAX_TRIANGLES
+     triangles, in the order they're already in: after MeshIndexer that's cache order, so neighbouring triangles
+     are already together and the clusters come out compact without reordering anything.
+     */
+    MeshletSet(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, unsigned int firstIndex, unsigned int indexCount) {
+        size_t nVertices = vertices.size() / MeshIndexer::FLOATS_PER_VERTEX;
+        //which meshlet last used each vertex, so membership is one compare
+        std::vector<unsigned int> lastMeshlet(nVertices, ~0u);
+        std::vector<unsigned int> used{};
+        Meshlet current{};
+        current.firstIndex = firstIndex;
+        auto finish = [&] {
+            if (current.indexCount == 0) {
+                return;
+            }
+            computeBounds(vertices, used, current);
+            meshlets.push_back(current);
+            current = Meshlet{};
+            used.clear();
+        };
+        for (unsigned int i = firstIndex; i + 2 < firstIndex + indexCount; i += 3) {
+            unsigned int id = (unsigned int)meshlets.size();
+            unsigned int nNew = 0;
+            for (int j = 0; j < 3; ++j) {
+                nNew += lastMeshlet[indices[i + j]] != id;
+            }
+            if (used.size() + nNew > MAX_VERTICES || current.indexCount / 3 + 1 > MAX_TRIANGLES) {
+                finish();
+                current.firstIndex = i;
+                id = (unsigned int)meshlets.size();
+            }
+            for (int j = 0; j < 3; ++j) {
+                if (lastMeshlet[indices[i + j]] != id) {
+                    lastMeshlet[indices[i + j]] = id;
+                    used.push_back(indices[i + j]);
+                }
+            }
+            current.indexCount += 3;
+        }
+        finish();
+        std::vector<AABB> boxes(meshlets.size());
+        for (size_t i = 0; i < meshlets.size(); ++i) {
+            boxes[i] = AABB(meshlets[i].centre - glm::vec3(meshlets[i].radius), meshlets[i].centre + glm::vec3(meshlets[i].radius));
+        }
+        bvh.build(boxes);
+    }
+    
+    const std::vector<Meshlet>& get() const {
+        return meshlets;
+    }
+    
+    size_t size() const {
+        return meshlets.size();
+    }
+    
+    /*
+     The meshlets that might be seen, with the frustum in the same space as the mesh. visit gets each survivor's
+     index. Returns how many were culled.
+     */
+    template <typename Visit>
+    size_t cull(const Frustum& frustum, Visit&& visit) const {
+        size_t nVisible = 0;
+        bvh.query([&](const AABB& box) {
+            return frustum.classify(box);
+        }, [&](int index, bool bInside) {
+            const Meshlet& meshlet = meshlets[index];
+            if (!bInside && !frustum.intersectsSphere(meshlet.centre, meshlet.radius)) {
+                return;
+            }
+            ++nVisible;
+            visit(index);
+        });
+        return meshlets.size() - nVisible;
+    }
+};
+
+#endif /* meshlet_h */
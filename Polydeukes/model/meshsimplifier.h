@@ -0,0 +1,362 @@
+//
+//  meshsimplifier.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef meshsimplifier_h
+#define meshsimplifier_h
+
+#include <glm.hpp>
+#include <vector>
+#include <array>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#include "meshindexer.h"
+
+//one level of detail: a run of the index buffer, and how far (model units) it strays from the full mesh
+struct MeshLod {
+    unsigned int firstIndex = 0;
+    unsigned int indexCount = 0;
+    float error = 0.0f;
+};
+
+/*
+ Quadric error metric simplification (Garland and Heckbert, "Surface Simplification Using Quadric Error
+ Metrics"). Every position gets the sum of the planes of the triangles around it, area weighted, and edges are
+ collapsed cheapest first. A collapse moves one end onto the other rather than to the optimal point, so the
+ coarse levels only use vertices that are already in the buffer and every level can share the one VBO.
+ 
+ Edges with only one triangle get an extra plane at right angles to it so open borders (scans are full of them)
+ don't get eaten. Collapses that would flip a triangle over are refused.
+ 
+ The chain is one pass: the collapses carry on from one level to the next and the quadrics keep everything
+ collapsed so far, so a level's error covers the whole way down from the full mesh.
+ */
+class MeshSimplifier {
+public:
+    
+    static constexpr int MAX_LEVELS = 6;
+
+private:
+    
+    static constexpr int FLOATS_PER_VERTEX = MeshIndexer::FLOATS_PER_VERTEX;
+    static constexpr double BOUNDARY_WEIGHT = 10.0;
+    //a level has to lose at least this much of the one before to be worth keeping
+    static constexpr float MIN_REDUCTION = 0.85f;
+    
+    //symmetric 4x4 as its 10 distinct terms, plus the area that went into it
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+        
+        static Quadric plane(const glm::dvec3& n, double d, double weight) {
+            Quadric q;
+            q.a2 = n.x * n.x * weight; q.ab = n.x * n.y * weight; q.ac = n.x * n.z * weight; q.ad = n.x * d * weight;
+            q.b2 = n.y * n.y * weight; q.bc = n.y * n.z * weight; q.bd = n.y * d * weight;
+            q.c2 = n.z * n.z * weight; q.cd = n.z * d * weight;
+            q.d2 = d * d * weight;
+            q.weight = weight;
+            return q;
+        }
+        
+        Quadric& operator+=(const Quadric& that) {
+            a2 += that.a2; ab += that.ab; ac += that.ac; ad += that.ad;
+            b2 += that.b2; bc += that.bc; bd += that.bd;
+            c2 += that.c2; cd += that.cd;
+            d2 += that.d2;
+            weight += that.weight;
+            return *this;
+        }
+        
+        //weighted sum of squared distances from p to the planes
+        double evaluate(const glm::dvec3& p) const {
+            return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+                 + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+                 + c2 * p.z * p.z + 2 * cd * p.z
+                 + d2;
+        }
+    };
+    
+    struct Collapse {
+        double cost;
+        unsigned int from, to;
+        //versions of both ends when it was queued, it's stale if either has changed since
+        unsigned int fromVersion, toVersion;
+        
+        bool operator>(const Collapse& that) const {
+            return cost > that.cost;
+        }
+    };
+    
+    struct PositionKeyHash {
+        size_t operator()(const std::array<uint32_t, 3>& key) const {
+            return ((size_t)key[0] * 73856093u) ^ ((size_t)key[1] * 19349663u) ^ ((size_t)key[2] * 83492791u);
+        }
+    };
+    
+    struct EdgeHash {
+        size_t operator()(const std::pair<unsigned int, unsigned int>& edge) const {
+            return ((size_t)edge.first << 32) ^ edge.second;
+        }
+    };
+    
+    /*
+     One range of the index buffer simplified down through every target triangle count. Snapshot k goes on the
+     end of levels[k]; errors[k] is raised to the worst collapse made before it.
+     */
+    static void simplifyRange(const std::vector<float>& vertices, const unsigned int* indices, size_t nIndices, const std::vector<size_t>& targets, std::vector<std::vector<unsigned int>>& levels, std::vector<float>& errors) {
+        //positions are what gets collapsed; vertices that only differ in normal or uv move together
+        std::unordered_map<std::array<uint32_t, 3>, unsigned int, PositionKeyHash> positionIds{};
+        std::vector<glm::dvec3> positions{};
+        //a vertex at each position, for corners whose own position has been collapsed away
+        std::vector<unsigned int> representative{};
+        //the vertex and position each corner started out with
+        std::vector<unsigned int> cornerVertex(nIndices);
+        std::vector<unsigned int> cornerPosition(nIndices);
+        std::vector<std::array<unsigned int, 3>> triangles{};
+        triangles.reserve(nIndices / 3);
+        for (size_t i = 0; i + 2 < nIndices; i += 3) {
+            std::array<unsigned int, 3> triangle;
+            for (int j = 0; j < 3; ++j) {
+                unsigned int vertex = indices[i + j];
+                const float* p = &vertices[FLOATS_PER_VERTEX * (size_t)vertex];
+                std::array<uint32_t, 3> key;
+                std::memcpy(key.data(), p, sizeof(key));
+                auto [found, bInserted] = positionIds.emplace(key, (unsigned int)positions.size());
+                if (bInserted) {
+                    positions.emplace_back(p[0], p[1], p[2]);
+                    representative.push_back(vertex);
+                }
+                triangle[j] = found->second;
+                cornerVertex[triangles.size() * 3 + j] = vertex;
+                cornerPosition[triangles.size() * 3 + j] = found->second;
+            }
+            triangles.push_back(triangle);
+        }
+        size_t nPositions = positions.size();
+        size_t nTriangles = triangles.size();
+        std::vector<bool> bAlive(nTriangles, true);
+        size_t nAlive = 0;
+        std::vector<Quadric> quadrics(nPositions);
+        std::vector<std::vector<unsigned int>> around(nPositions);
+        std::unordered_map<std::pair<unsigned int, unsigned int>, int, EdgeHash> edgeUse{};
+        for (size_t t = 0; t < nTriangles; ++t) {
+            const auto& triangle = triangles[t];
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+                bAlive[t] = false;
+                continue;
+            }
+            ++nAlive;
+            glm::dvec3 normal = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+            double length = glm::length(normal);
+            if (length > 0.0) {
+                Quadric q = Quadric::plane(normal / length, -glm::dot(normal / length, positions[triangle[0]]), length * 0.5);
+                for (unsigned int p : triangle) {
+                    quadrics[p] += q;
+                }
+            }
+            for (int j = 0; j < 3; ++j) {
+                around[triangle[j]].push_back((unsigned int)t);
+                unsigned int a = triangle[j], b = triangle[(j + 1) % 3];
+                ++edgeUse[{std::min(a, b), std::max(a, b)}];
+            }
+        }
+        //border edges: a plane through the edge at right angles to its one triangle
+        for (size_t t = 0; t < nTriangles; ++t) {
+            if (!bAlive[t]) {
+                continue;
+            }
+            const auto& triangle = triangles[t];
+            glm::dvec3 normal = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+            for (int j = 0; j < 3; ++j) {
+                unsigned int a = triangle[j], b = triangle[(j + 1) % 3];
+                if (edgeUse[{std::min(a, b), std::max(a, b)}] != 1) {
+                    continue;
+                }
+                glm::dvec3 edge = positions[b] - positions[a];
+                glm::dvec3 side = glm::cross(edge, normal);
+                double length = glm::length(side);
+                if (length <= 0.0) {
+                    continue;
+                }
+                side /= length;
+                Quadric q = Quadric::plane(side, -glm::dot(side, positions[a]), glm::dot(edge, edge) * BOUNDARY_WEIGHT);
+                quadrics[a] += q;
+                quadrics[b] += q;
+            }
+        }
+        edgeUse.clear();
+        positionIds.clear();
+        
+        std::vector<bool> bCollapsed(nPositions, false);
+        std::vector<unsigned int> version(nPositions, 0);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue{};
+        auto push = [&](unsigned int a, unsigned int b) {
+            Quadric q = quadrics[a];
+            q += quadrics[b];
+            double toB = q.evaluate(positions[b]);
+            double toA = q.evaluate(positions[a]);
+            if (toB <= toA) {
+                queue.push({toB, a, b, version[a], version[b]});
+            }
+            else {
+                queue.push({toA, b, a, version[b], version[a]});
+            }
+        };
+        for (size_t t = 0; t < nTriangles; ++t) {
+            if (!bAlive[t]) {
+                continue;
+            }
+            //interior edges go in twice, whichever comes out second is stale or refused like the first
+            for (int j = 0; j < 3; ++j) {
+                push(triangles[t][j], triangles[t][(j + 1) % 3]);
+            }
+        }
+        //moving from onto to mustn't turn any of from's other triangles over
+        auto flips = [&](unsigned int from, unsigned int to) {
+            for (unsigned int t : around[from]) {
+                if (!bAlive[t]) {
+                    continue;
+                }
+                const auto& triangle = triangles[t];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                    continue;
+                }
+                glm::dvec3 p[3], moved[3];
+                for (int j = 0; j < 3; ++j) {
+                    p[j] = positions[triangle[j]];
+                    moved[j] = triangle[j] == from ? positions[to] : p[j];
+                }
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if (glm::dot(before, after) <= 0.0) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        auto snapshot = [&](size_t level) {
+            for (size_t t = 0; t < nTriangles; ++t) {
+                if (!bAlive[t]) {
+                    continue;
+                }
+                for (int j = 0; j < 3; ++j) {
+                    size_t corner = 3 * t + j;
+                    //the corner keeps its own vertex (and so its uv and normal) unless its position went away
+                    levels[level].push_back(triangles[t][j] == cornerPosition[corner] ? cornerVertex[corner] : representative[triangles[t][j]]);
+                }
+            }
+        };
+        double worst = 0.0;
+        std::vector<unsigned int> neighbours{};
+        for (size_t level = 0; level < targets.size(); ++level) {
+            while (nAlive > targets[level] && !queue.empty()) {
+                Collapse collapse = queue.top();
+                queue.pop();
+                unsigned int from = collapse.from, to = collapse.to;
+                if (bCollapsed[from] || bCollapsed[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion) {
+                    continue;
+                }
+                if (flips(from, to)) {
+                    continue;
+                }
+                Quadric merged = quadrics[from];
+                merged += quadrics[to];
+                if (merged.weight > 0.0) {
+                    worst = std::max(worst, std::max(0.0, collapse.cost) / merged.weight);
+                }
+                quadrics[to] = merged;
+                bCollapsed[from] = true;
+                ++version[to];
+                for (unsigned int t : around[from]) {
+                    if (!bAlive[t]) {
+                        continue;
+                    }
+                    auto& triangle = triangles[t];
+                    for (unsigned int& p : triangle) {
+                        if (p == from) {
+                            p = to;
+                        }
+                    }
+                    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+                        bAlive[t] = false;
+                        --nAlive;
+                    }
+                    else {
+                        around[to].push_back(t);
+                    }
+                }
+                around[from].clear();
+                around[from].shrink_to_fit();
+                //drop the dead ones and requeue every edge out of to
+                auto& mine = around[to];
+                mine.erase(std::remove_if(mine.begin(), mine.end(), [&](unsigned int t) { return !bAlive[t]; }), mine.end());
+                std::sort(mine.begin(), mine.end());
+                mine.erase(std::unique(mine.begin(), mine.end()), mine.end());
+                neighbours.clear();
+                for (unsigned int t : mine) {
+                    for (unsigned int p : triangles[t]) {
+                        if (p != to) {
+                            neighbours.push_back(p);
+                        }
+                    }
+                }
+                std::sort(neighbours.begin(), neighbours.end());
+                neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+                for (unsigned int p : neighbours) {
+                    push(to, p);
+                }
+            }
+            errors[level] = std::max(errors[level], (float)std::sqrt(worst));
+            snapshot(level);
+        }
+    }
+
+public:
+    
+    /*
+     Appends up to maxLevels - 1 simplified copies of the mesh to indices, each about half the triangles of the
+     one before, and returns the chain with the full mesh (the indices as they were) as level 0. Stops early
+     once simplifying stops getting anywhere. ranges are (first index, index count) runs that are simplified
+     separately so their borders stay put (OBJ groups); everything is one run if it's empty. The new levels
+     come out ordered for the vertex cache.
+     */
+    static std::vector<MeshLod> buildLodChain(const std::vector<float>& vertices, std::vector<unsigned int>& indices, std::vector<std::pair<unsigned int, unsigned int>> ranges = {}, int maxLevels = MAX_LEVELS) {
+        std::vector<MeshLod> chain{};
+        chain.push_back({0u, (unsigned int)indices.size(), 0.0f});
+        if (ranges.empty()) {
+            ranges.emplace_back(0u, (unsigned int)indices.size());
+        }
+        size_t nCoarse = (size_t)std::max(0, maxLevels - 1);
+        std::vector<std::vector<unsigned int>> levels(nCoarse);
+        std::vector<float> errors(nCoarse, 0.0f);
+        for (auto [first, count] : ranges) {
+            std::vector<size_t> targets(nCoarse);
+            for (size_t level = 0; level < nCoarse; ++level) {
+                targets[level] = (count / 3) >> (level + 1);
+            }
+            simplifyRange(vertices, indices.data() + first, count, targets, levels, errors);
+        }
+        size_t nVertices = vertices.size() / FLOATS_PER_VERTEX;
+        for (size_t level = 0; level < nCoarse; ++level) {
+            std::vector<unsigned int>& levelIndices = levels[level];
+            if (levelIndices.empty() || levelIndices.size() > chain.back().indexCount * MIN_REDUCTION) {
+                break;
+            }
+            MeshIndexer::optimizeVertexCache(levelIndices, nVertices, {{0u, (unsigned int)levelIndices.size()}});
+            chain.push_back({(unsigned int)indices.size(), (unsigned int)levelIndices.size(), errors[level]});
+            indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+        }
+        return chain;
+    }
+};
+
+#endif /* meshsimplifier_h */
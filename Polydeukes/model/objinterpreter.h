@@ -12,55 +12,178 @@
 #include <glad/glad.h>
 #include "ShaderProgram.h"
 #include "../model/vector.h"
+#include "objparser.h"
+#include "meshindexer.h"
+#include "meshsimplifier.h"
+#include "meshlet.h"
+#include "frustum.h"
 
 #include <memory>
+#include <numeric>
+#include <algorithm>
+#include <limits>
 
 class ArbitraryShape : public Shape, public std::enable_shared_from_this<ArbitraryShape> {
+public:
+    
+    /*
+     Everything a shape needs that can be worked out off the render thread: the CPU copy of its buffers, the
+     picking mesh (and its BVH) and the meshlets. adopt() takes it on the render thread.
+     */
+    struct Prepared {
+        std::vector<float> vertices{};
+        std::vector<unsigned int> indices{};
+        std::vector<ObjGroup> groups{};
+        std::vector<MeshLod> lods{};
+        Mesh mesh{};
+        std::shared_ptr<const MeshletSet> meshlets{};
+    };
+    
 private:
-    unsigned int VAO, VBO;
-    unsigned int nVertices = 0;
-    ArbitraryShape(ArbitraryShape& that) : Shape(that), VAO(that.VAO), VBO(that.VBO), nVertices(that.nVertices) {}
+    //coarsest level allowed when its error is at most this big on screen
+    static constexpr float MAX_PIXEL_ERROR = 1.0f;
+    //below this one draw call is cheaper than culling clusters
+    static constexpr unsigned int MIN_MESHLET_TRIANGLES = 1 << 16;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    std::vector<ObjGroup> groups{};
+    //ranges of the EBO, level 0 is the full mesh
+    std::vector<MeshLod> lods{};
+    int lod = 0;
+    //clusters of level 0 for big meshes, shared with clones
+    std::shared_ptr<const MeshletSet> meshlets{};
+    //this frame's surviving meshlets as glMultiDrawElements ranges, when bDrawMeshlets
+    bool bDrawMeshlets = false;
+    std::vector<GLsizei> drawCounts{};
+    std::vector<const void*> drawOffsets{};
+    std::vector<int> visibleMeshlets{};
+    size_t nCulledMeshlets = 0;
+    //the buffers' CPU copy while streamStep is still sending it up, nothing gets drawn until it's all there
+    std::unique_ptr<Prepared> staging{};
+    size_t nBytesUploaded = 0;
+    bool bResident = false;
+    //a clone taken while it's still streaming stays a placeholder, clone once it's resident
+    ArbitraryShape(ArbitraryShape& that) : Shape(that), VAO(that.VAO), VBO(that.VBO), EBO(that.EBO), groups(that.groups), lods(that.lods), lod(that.lod), meshlets(that.meshlets), bResident(that.bResident) {}
+    
+    /*
+     Level 0 culled meshlet by meshlet against the frustum, in model space. Survivors next to each other in the
+     index buffer get merged into one range.
+     */
+    void cullMeshlets(const glm::mat4& view, const glm::mat4& projection) {
+        Frustum frustum(projection * view * modellingTransform);
+        visibleMeshlets.clear();
+        nCulledMeshlets = meshlets->cull(frustum, [&](int index) {
+            visibleMeshlets.push_back(index);
+        });
+        std::sort(visibleMeshlets.begin(), visibleMeshlets.end());
+        drawCounts.clear();
+        drawOffsets.clear();
+        unsigned int end = 0;
+        for (int index : visibleMeshlets) {
+            const Meshlet& meshlet = meshlets->get()[index];
+            if (!drawCounts.empty() && meshlet.firstIndex == end) {
+                drawCounts.back() += meshlet.indexCount;
+            }
+            else {
+                drawCounts.push_back(meshlet.indexCount);
+                drawOffsets.push_back((const void*)(meshlet.firstIndex * sizeof(unsigned int)));
+            }
+            end = meshlet.firstIndex + meshlet.indexCount;
+        }
+    }
     
+    //triangle soup -> welded, smooth shaded and cache ordered by MeshIndexer
     void init(std::vector<Triangle> positions) {
         std::vector<float> vertices;
+        vertices.reserve(positions.size() * 3 * MeshIndexer::FLOATS_PER_VERTEX);
         for (auto triangle : positions) {
-            glm::vec3 u = triangle.a - triangle.b;
-            glm::vec3 v = triangle.a - triangle.c;
-            glm::vec3 normal = glm::cross(u, v);
-            vertices.push_back(triangle.a.x);
-            vertices.push_back(triangle.a.y);
-            vertices.push_back(triangle.a.z);
-            vertices.push_back(normal.x);
-            vertices.push_back(normal.y);
-            vertices.push_back(normal.z);
-            vertices.push_back(0.f);
-            vertices.push_back(0.f);
-            
-            vertices.push_back(triangle.b.x);
-            vertices.push_back(triangle.b.y);
-            vertices.push_back(triangle.b.z);
-            vertices.push_back(normal.x);
-            vertices.push_back(normal.y);
-            vertices.push_back(normal.z);
-            vertices.push_back(0.f);
-            vertices.push_back(0.f);
-            
-            vertices.push_back(triangle.c.x);
-            vertices.push_back(triangle.c.y);
-            vertices.push_back(triangle.c.z);
-            vertices.push_back(normal.x);
-            vertices.push_back(normal.y);
-            vertices.push_back(normal.z);
-            vertices.push_back(0.f);
-            vertices.push_back(0.f);
-            nVertices+=3;
-        }
-        mesh = Mesh(vertices.data(), (int)vertices.size());
+            for (const glm::vec3& corner : {triangle.a, triangle.b, triangle.c}) {
+                //zero normal, MeshIndexer fills it in
+                vertices.insert(vertices.end(), {corner.x, corner.y, corner.z, 0.f, 0.f, 0.f, 0.f, 0.f});
+            }
+        }
+        std::vector<unsigned int> indices(positions.size() * 3);
+        std::iota(indices.begin(), indices.end(), 0u);
+        MeshIndexer::optimize(vertices, indices);
+        unsigned int nIndices = (unsigned int)indices.size();
+        uploadNow(prepare(std::move(vertices), std::move(indices), {{0u, nIndices, 0.0f}}));
+    }
+    
+    void uploadNow(Prepared&& prepared) {
+        adopt(std::move(prepared));
+        size_t budget = std::numeric_limits<size_t>::max();
+        streamStep(budget);
+    }
+    
+    //the current level (or this frame's meshlets) as wireframe or filled
+    void draw(ShaderProgram& shaderProgram, GLenum polygonMode) {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode);
+        glBindVertexArray(VAO);
+        if (bDrawMeshlets && lod == 0) {
+            if (!drawCounts.empty()) {
+                glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), (GLsizei)drawCounts.size());
+            }
+        }
+        else {
+            glDrawElements(GL_TRIANGLES, lods[lod].indexCount, GL_UNSIGNED_INT, (void*)(lods[lod].firstIndex * sizeof(unsigned int)));
+        }
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+    
+public:
+    
+    unsigned int getVAO() const override {
+        return VAO;
+    }
+    
+    /*
+     The CPU half of loading, safe on any thread since it doesn't touch GL: wraps the buffers with the picking
+     mesh (BVH built now rather than stalling the first hover) and, for big meshes, the meshlets.
+     */
+    static Prepared prepare(std::vector<float> vertices, std::vector<unsigned int> indices, std::vector<MeshLod> lods) {
+        Prepared prepared{};
+        if (lods.empty()) {
+            lods.push_back({0u, (unsigned int)indices.size(), 0.0f});
+        }
+        //picking (and the AABB) always goes by the full mesh
+        std::vector<unsigned int> full(indices.begin() + lods[0].firstIndex, indices.begin() + lods[0].firstIndex + lods[0].indexCount);
+        prepared.mesh = Mesh(vertices, full);
+        prepared.mesh.getBVH();
+        if (lods[0].indexCount / 3 >= MIN_MESHLET_TRIANGLES) {
+            prepared.meshlets = std::make_shared<const MeshletSet>(vertices, indices, lods[0].firstIndex, lods[0].indexCount);
+        }
+        prepared.vertices = std::move(vertices);
+        prepared.indices = std::move(indices);
+        prepared.lods = std::move(lods);
+        return prepared;
+    }
+    
+    static Prepared prepare(ObjData&& data) {
+        Prepared prepared = prepare(std::move(data.vertices), std::move(data.indices), std::move(data.lods));
+        prepared.groups = std::move(data.groups);
+        return prepared;
+    }
+    
+    /*
+     Render thread. Takes the prepared data and allocates the buffers, empty: the contents go up through
+     streamStep, and until they're all there the shape only draws its bounding box.
+     */
+    void adopt(Prepared&& prepared) {
+        groups = std::move(prepared.groups);
+        lods = std::move(prepared.lods);
+        meshlets = std::move(prepared.meshlets);
+        mesh = prepared.mesh;
+        //it may have been moved while it was loading
+        mesh.setTransform(modellingTransform);
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, prepared.vertices.size() * sizeof(float), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, prepared.indices.size() * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
         glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(float) * 8, (void*)0);
         glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(float) * 8, (void*)(3*sizeof(float)));
         glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(float) * 8, (void*)(6*sizeof(float)));
@@ -68,17 +191,125 @@ private:
         glEnableVertexAttribArray(1);
         glEnableVertexAttribArray(2);
         glBindVertexArray(0);
+        staging = std::make_unique<Prepared>();
+        staging->vertices = std::move(prepared.vertices);
+        staging->indices = std::move(prepared.indices);
+        nBytesUploaded = 0;
+        bResident = false;
+    }
+    
+    /*
+     Render thread. Sends up to budget bytes of the vertices then the indices (through the copy target, so the
+     bound VAO's element buffer isn't touched) and takes off what it sent. True once it's all resident.
+     */
+    bool streamStep(size_t& budget) {
+        if (bResident) {
+            return true;
+        }
+        size_t vertexBytes = staging->vertices.size() * sizeof(float);
+        size_t indexBytes = staging->indices.size() * sizeof(unsigned int);
+        while (budget > 0 && nBytesUploaded < vertexBytes + indexBytes) {
+            bool bVertices = nBytesUploaded < vertexBytes;
+            size_t offset = bVertices ? nBytesUploaded : nBytesUploaded - vertexBytes;
+            size_t n = std::min(budget, (bVertices ? vertexBytes : indexBytes) - offset);
+            const char* source = bVertices ? (const char*)staging->vertices.data() : (const char*)staging->indices.data();
+            glBindBuffer(GL_COPY_WRITE_BUFFER, bVertices ? VBO : EBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, n, source + offset);
+            nBytesUploaded += n;
+            budget -= n;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (nBytesUploaded < vertexBytes + indexBytes) {
+            return false;
+        }
+        staging.reset();
+        bResident = true;
+        return true;
     }
-public:
     
-    virtual std::vector<glm::vec3> getAABB() override {
-        return {glm::vec3(0.f,0.f,0.f), glm::vec3(0.f,0.f,0.f)};
+    bool isResident() const {
+        return bResident;
+    }
+    
+    //nothing to draw until it's handed its data, see AssetStreamer::loadObj
+    ArbitraryShape() {
+        colour = glm::vec4(1.0f,1.0f,1.0f,.5f);
     }
     
     explicit ArbitraryShape(std::vector<Triangle> positions) {
         init(positions);
     }
     
+    //the loaded vertices and indices go into the buffers as they are, ObjParser::load has already optimized them
+    explicit ArbitraryShape(ObjData data) {
+        colour = glm::vec4(1.0f,1.0f,1.0f,.5f);
+        uploadNow(prepare(std::move(data)));
+    }
+    
+    /*
+     The coarsest level whose error, projected at the near side of the bounding sphere, stays under
+     MAX_PIXEL_ERROR pixels. The full mesh whenever the camera is inside the sphere.
+     */
+    void selectLevelOfDetail(const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+        lod = 0;
+        if (lods.size() < 2) {
+            return;
+        }
+        glm::vec3 localCentre = (mesh.getLocalMin() + mesh.getLocalMax()) * 0.5f;
+        float localRadius = glm::length(mesh.getLocalMax() - mesh.getLocalMin()) * 0.5f;
+        float scale = std::max({glm::length(glm::vec3(modellingTransform[0])), glm::length(glm::vec3(modellingTransform[1])), glm::length(glm::vec3(modellingTransform[2]))});
+        glm::vec4 centre = view * modellingTransform * glm::vec4(localCentre, 1.0f);
+        float distance = -centre.z - localRadius * scale;
+        if (distance <= 0.0f) {
+            return;
+        }
+        float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f / distance;
+        for (int level = (int)lods.size() - 1; level > 0; --level) {
+            if (lods[level].error * scale * pixelsPerUnit <= MAX_PIXEL_ERROR) {
+                lod = level;
+                return;
+            }
+        }
+    }
+    
+    //level first, then the meshlets if it's the full mesh
+    void updateView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight) override {
+        if (!bResident) {
+            return;
+        }
+        selectLevelOfDetail(view, projection, viewportHeight);
+        bDrawMeshlets = lod == 0 && meshlets != nullptr;
+        if (bDrawMeshlets) {
+            cullMeshlets(view, projection);
+        }
+    }
+    
+    size_t getMeshletCount() const {
+        return meshlets ? meshlets->size() : 0;
+    }
+    
+    //as of the last updateView
+    size_t getCulledMeshletCount() const {
+        return bDrawMeshlets ? nCulledMeshlets : 0;
+    }
+    
+    //the GPU picker gets the full mesh filled in, same as the ray picker (less any meshlets outside the
+    //frustum), so the id under the cursor is the surface's rather than only the wires'
+    void renderID(ShaderProgram& shaderProgram) override {
+        if (!bResident) {
+            return;
+        }
+        int selected = lod;
+        lod = 0;
+        draw(shaderProgram, GL_FILL);
+        lod = selected;
+    }
+    
+    //o/g/usemtl runs from the OBJ, as index ranges of level 0
+    const std::vector<ObjGroup>& getGroups() const {
+        return groups;
+    }
+    
     //TODO: Rectify this disaster. 
     void initReferenceToThis() {
         referenceToThis = shared_from_this();
@@ -99,13 +330,15 @@ public:
         init(triangles);
     }
     
-    void render(ShaderProgram shaderProgram) override {
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, nVertices);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    void render(ShaderProgram& shaderProgram) override {
+        //still streaming: its box once the mesh is known, nothing before that
+        if (!bResident) {
+            if (mesh.size() > 0) {
+                Shape::renderAABB(getAABB(), shaderProgram);
+            }
+            return;
+        }
+        draw(shaderProgram, GL_LINE);
         //std::vector<glm::vec3> positions = mesh.getPosition();
         //renderAABB(computeAABB(positions), shaderProgram);
     }
@@ -118,74 +351,18 @@ public:
 };
 
 class objInterpreter {
-private:
-    
-    static std::vector<int> parseFaceLine(std::string delim, std::string line) {
-        std::vector<std::string> tokens;
-        std::stringstream ss(line);
-        std::string token;
-        while (std::getline(ss, token, ' ')) {
-            if (delim != "") {
-                token = token.substr(0, token.find(delim, 0));
-            }
-            tokens.push_back(token);
-        }
-        std::vector<int> face{};
-        for (int i = 1; i < tokens.size(); ++i) {
-            face.push_back(std::stoi(tokens[i])-1);
-        }
-        return face;
-    }
-    
 public:
+    
+    /*
+     Through ObjParser, so a scan that's been opened before comes straight out of its binary cache.
+     */
     static std::shared_ptr<Shape> interpretObjFile(std::string objFile) {
-        std::ifstream inputFile(objFile);
-        if (!inputFile) {
+        ObjData data{};
+        if (!ObjParser::load(objFile, data)) {
             std::cerr << "Failed to open the file " << objFile << std::endl;
             return std::shared_ptr<Shape>(nullptr);
         }
-        std::string line{};
-        std::vector<glm::vec3> positions{};
-        std::vector<std::vector<int>> faces{};
-        
-        while (std::getline(inputFile,line)) {
-            if (line.length() == 0) {
-                continue;
-            }
-            if (line.at(0) == '#') {
-                continue;
-            }
-            if (line.at(0) == 'v' && line.at(1) == ' ') {
-                std::vector<std::string> tokens;
-                std::stringstream ss(line);
-                std::string token;
-                while (std::getline(ss, token, ' ')) {
-                    tokens.push_back(token);
-                }
-                glm::vec3 position = glm::vec3(std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]));
-                positions.push_back(position);
-                continue;
-            }
-            if (line.at(0) == 'f') {
-                if (line.find('/') == std::string::npos)
-                {
-                    faces.push_back(parseFaceLine("", line));
-                }
-                else if (line.find("//") != std::string::npos)
-                {
-                    faces.push_back(parseFaceLine("//", line));
-                }
-                else if (std::count(line.begin(), line.end(), '/') == 3)
-                {
-                    faces.push_back(parseFaceLine("/", line));
-                }
-                else
-                {
-                    faces.push_back(parseFaceLine("/", line));
-                }
-            }
-        }
-        std::shared_ptr<ArbitraryShape> shape = std::shared_ptr<ArbitraryShape>(new ArbitraryShape(positions, faces));
+        std::shared_ptr<ArbitraryShape> shape = std::shared_ptr<ArbitraryShape>(new ArbitraryShape(std::move(data)));
         shape->initReferenceToThis();
         return shape;
     }
@@ -0,0 +1,636 @@
+//
+//  objparser.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef objparser_h
+#define objparser_h
+
+#include <glm.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <iostream>
+#include <charconv>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "threadpool.h"
+#include "meshindexer.h"
+#include "meshsimplifier.h"
+
+/*
+ Read only view of a whole file. Mapped when the OS lets us (no copy, pages come in as the parser reaches
+ them), otherwise read into memory.
+ */
+class MappedFile {
+private:
+    const char* mapped = nullptr;
+    std::vector<char> buffer{};
+    size_t length = 0;
+
+public:
+    
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            length = (size_t)info.st_size;
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                mapped = (const char*)address;
+            }
+            else {
+                buffer.resize(length);
+                if (pread(fd, buffer.data(), length, 0) != (ssize_t)length) {
+                    buffer.clear();
+                    length = 0;
+                }
+            }
+        }
+        close(fd);
+    }
+    
+    ~MappedFile() {
+        if (mapped) {
+            munmap((void*)mapped, length);
+        }
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool isOpen() const {
+        return length > 0;
+    }
+    
+    const char* data() const {
+        return mapped ? mapped : buffer.data();
+    }
+    
+    size_t size() const {
+        return length;
+    }
+};
+
+//a run of indices that share an object, group and material
+struct ObjGroup {
+    std::string object{};
+    std::string group{};
+    std::string material{};
+    unsigned int firstIndex = 0;
+    unsigned int indexCount = 0;
+};
+
+/*
+ What an OBJ boils down to: interleaved vertices laid out like every other mesh here (position, normal, uv;
+ 8 floats) and triangle indices into them, ready to go straight into a VBO and an EBO.
+ 
+ Corners that agree on position, uv and normal share a vertex. Corners without a normal share theirs too and
+ get a smooth one from MeshIndexer when the OBJ is loaded.
+ 
+ Once loaded, indices also holds the coarser levels of detail after the full mesh; lods says where each one is
+ (level 0 is the full mesh, and the only one the groups describe).
+ */
+struct ObjData {
+    static constexpr int FLOATS_PER_VERTEX = 8;
+    std::vector<float> vertices{};
+    std::vector<unsigned int> indices{};
+    std::vector<ObjGroup> groups{};
+    std::vector<MeshLod> lods{};
+    
+    size_t getVertexCount() const {
+        return vertices.size() / FLOATS_PER_VERTEX;
+    }
+};
+
+/*
+ OBJ loader for big scans. The file is mapped, cut into chunks on line boundaries and the chunks are parsed on
+ the thread pool with from_chars, then stitched together. Handles v/vt/vn, faces in any of the slash forms
+ with negative (relative) indices, and o/g/usemtl. Polygons are fanned into triangles. Anything else (mtllib,
+ s, l, ...) is skipped.
+ 
+ load() also runs the result through MeshIndexer (welded, smooth normals, reordered for the vertex cache),
+ builds the LOD chain with MeshSimplifier and caches it all next to the OBJ in a flat binary file that loads
+ with a couple of reads. The cache remembers the OBJ's size and modification time and is rebuilt when they
+ change.
+ */
+class ObjParser {
+private:
+    
+    static constexpr uint32_t CACHE_MAGIC = 0x4d4b4450; //"PDKM"
+    static constexpr uint32_t CACHE_VERSION = 3;
+    //below this it isn't worth waking the pool
+    static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+    
+    //face corner as written; the index flags say which of vt/vn are there and which indices were negative
+    struct Corner {
+        int v = 0;
+        int vt = 0;
+        int vn = 0;
+        uint8_t flags = 0;
+    };
+    
+    static constexpr uint8_t HAS_TEXTURE = 1;
+    static constexpr uint8_t HAS_NORMAL = 2;
+    static constexpr uint8_t RELATIVE_POSITION = 4;
+    static constexpr uint8_t RELATIVE_TEXTURE = 8;
+    static constexpr uint8_t RELATIVE_NORMAL = 16;
+    
+    enum class GroupKind { OBJECT, GROUP, MATERIAL };
+    
+    struct GroupEvent {
+        GroupKind kind;
+        std::string name;
+        //triangle (within the chunk) it starts at
+        size_t triangle;
+    };
+    
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        std::vector<glm::vec3> positions{};
+        std::vector<glm::vec3> normals{};
+        std::vector<glm::vec2> textures{};
+        //three per triangle
+        std::vector<Corner> corners{};
+        std::vector<GroupEvent> groupEvents{};
+    };
+    
+    struct VertexKey {
+        int v, vt, vn;
+        
+        bool operator==(const VertexKey& that) const {
+            return v == that.v && vt == that.vt && vn == that.vn;
+        }
+    };
+    
+    struct VertexKeyHash {
+        size_t operator()(const VertexKey& key) const {
+            return ((size_t)key.v * 73856093u) ^ ((size_t)key.vt * 19349663u) ^ ((size_t)key.vn * 83492791u);
+        }
+    };
+    
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+    
+    static const char* skipSpace(const char* p, const char* end) {
+        while (p < end && isSpace(*p)) {
+            ++p;
+        }
+        return p;
+    }
+    
+    /*
+     Float at p, false if there isn't one. Apple's libc++ has only had the floating point from_chars recently,
+     older ones go through strtof on a terminated copy (the mapping isn't terminated).
+     */
+    static bool parseFloat(const char*& p, const char* end, float& value) {
+        p = skipSpace(p, end);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        //from_chars doesn't take a leading +
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+#else
+        char token[64];
+        size_t n = 0;
+        while (p + n < end && n < sizeof(token) - 1 && !isSpace(p[n]) && p[n] != '\n') {
+            token[n] = p[n];
+            ++n;
+        }
+        token[n] = '\0';
+        char* parsedEnd = nullptr;
+        value = std::strtof(token, &parsedEnd);
+        if (parsedEnd == token) {
+            return false;
+        }
+        p += parsedEnd - token;
+        return true;
+#endif
+    }
+    
+    static bool parseInt(const char*& p, const char* end, int& value) {
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+    
+    //positive indices count from 1, negative ones back from the latest element, which we only know within the chunk for now
+    static int resolveIndex(int index, size_t count, uint8_t relativeFlag, uint8_t& flags) {
+        if (index < 0) {
+            flags |= relativeFlag;
+            return (int)count + index;
+        }
+        return index - 1;
+    }
+    
+    //one v/vt/vn corner, e.g. 3, 3/7, 3//2 or 3/7/2
+    static bool parseCorner(const char*& p, const char* end, const Chunk& chunk, Corner& corner) {
+        int index;
+        if (!parseInt(p, end, index)) {
+            return false;
+        }
+        corner.v = resolveIndex(index, chunk.positions.size(), RELATIVE_POSITION, corner.flags);
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                if (!parseInt(p, end, index)) {
+                    return false;
+                }
+                corner.vt = resolveIndex(index, chunk.textures.size(), RELATIVE_TEXTURE, corner.flags);
+                corner.flags |= HAS_TEXTURE;
+            }
+            if (p < end && *p == '/') {
+                ++p;
+                if (!parseInt(p, end, index)) {
+                    return false;
+                }
+                corner.vn = resolveIndex(index, chunk.normals.size(), RELATIVE_NORMAL, corner.flags);
+                corner.flags |= HAS_NORMAL;
+            }
+        }
+        return true;
+    }
+    
+    static std::string restOfLine(const char* p, const char* lineEnd) {
+        p = skipSpace(p, lineEnd);
+        const char* last = lineEnd;
+        while (last > p && isSpace(last[-1])) {
+            --last;
+        }
+        return std::string(p, last);
+    }
+    
+    static bool startsWith(const char* p, const char* lineEnd, const char* keyword) {
+        size_t n = std::strlen(keyword);
+        return (size_t)(lineEnd - p) > n && std::memcmp(p, keyword, n) == 0 && isSpace(p[n]);
+    }
+    
+    static void parseChunk(Chunk& chunk) {
+        const char* p = chunk.begin;
+        std::vector<Corner> face{};
+        while (p < chunk.end) {
+            const char* lineEnd = (const char*)std::memchr(p, '\n', chunk.end - p);
+            if (!lineEnd) {
+                lineEnd = chunk.end;
+            }
+            p = skipSpace(p, lineEnd);
+            if (p == lineEnd || *p == '#') {
+                p = lineEnd + 1;
+                continue;
+            }
+            if (startsWith(p, lineEnd, "v")) {
+                glm::vec3 position;
+                const char* q = p + 1;
+                if (parseFloat(q, lineEnd, position.x) && parseFloat(q, lineEnd, position.y) && parseFloat(q, lineEnd, position.z)) {
+                    chunk.positions.push_back(position);
+                }
+            }
+            else if (startsWith(p, lineEnd, "vn")) {
+                glm::vec3 normal;
+                const char* q = p + 2;
+                if (parseFloat(q, lineEnd, normal.x) && parseFloat(q, lineEnd, normal.y) && parseFloat(q, lineEnd, normal.z)) {
+                    chunk.normals.push_back(normal);
+                }
+            }
+            else if (startsWith(p, lineEnd, "vt")) {
+                glm::vec2 texture(0.0f);
+                const char* q = p + 2;
+                if (parseFloat(q, lineEnd, texture.x)) {
+                    //v is optional
+                    parseFloat(q, lineEnd, texture.y);
+                    chunk.textures.push_back(texture);
+                }
+            }
+            else if (startsWith(p, lineEnd, "f")) {
+                face.clear();
+                const char* q = skipSpace(p + 1, lineEnd);
+                while (q < lineEnd) {
+                    Corner corner{};
+                    if (!parseCorner(q, lineEnd, chunk, corner)) {
+                        break;
+                    }
+                    face.push_back(corner);
+                    q = skipSpace(q, lineEnd);
+                }
+                for (size_t i = 2; i < face.size(); ++i) {
+                    chunk.corners.push_back(face[0]);
+                    chunk.corners.push_back(face[i - 1]);
+                    chunk.corners.push_back(face[i]);
+                }
+            }
+            else if (startsWith(p, lineEnd, "o")) {
+                chunk.groupEvents.push_back({GroupKind::OBJECT, restOfLine(p + 1, lineEnd), chunk.corners.size() / 3});
+            }
+            else if (startsWith(p, lineEnd, "g")) {
+                chunk.groupEvents.push_back({GroupKind::GROUP, restOfLine(p + 1, lineEnd), chunk.corners.size() / 3});
+            }
+            else if (startsWith(p, lineEnd, "usemtl")) {
+                chunk.groupEvents.push_back({GroupKind::MATERIAL, restOfLine(p + 6, lineEnd), chunk.corners.size() / 3});
+            }
+            p = lineEnd + 1;
+        }
+    }
+    
+    //chunks of roughly equal size, each ending just after a newline
+    static std::vector<Chunk> split(const char* data, size_t size) {
+        size_t nChunks = std::max<size_t>(1, std::min<size_t>(4 * (ThreadPool::getInstance().size() + 1), size / MIN_CHUNK_SIZE));
+        std::vector<Chunk> chunks(nChunks);
+        const char* begin = data;
+        const char* end = data + size;
+        for (size_t i = 0; i < nChunks; ++i) {
+            chunks[i].begin = begin;
+            const char* target = i + 1 == nChunks ? end : std::max(begin, data + size / nChunks * (i + 1));
+            const char* newline = target < end ? (const char*)std::memchr(target, '\n', end - target) : nullptr;
+            chunks[i].end = newline ? newline + 1 : end;
+            begin = chunks[i].end;
+        }
+        return chunks;
+    }
+    
+    /*
+     Stitches the chunks together: relative indices get the element counts of the chunks before them, each
+     distinct position/uv/normal triple becomes one vertex, and the group events become index ranges.
+     */
+    static void merge(std::vector<Chunk>& chunks, ObjData& data) {
+        std::vector<glm::vec3> positions{}, normals{};
+        std::vector<glm::vec2> textures{};
+        size_t nCorners = 0;
+        for (const Chunk& chunk : chunks) {
+            nCorners += chunk.corners.size();
+        }
+        data.vertices.clear();
+        data.indices.clear();
+        data.groups.clear();
+        data.indices.reserve(nCorners);
+        std::unordered_map<VertexKey, unsigned int, VertexKeyHash> vertexIndices{};
+        ObjGroup current{};
+        auto startGroup = [&] {
+            if (!data.groups.empty()) {
+                ObjGroup& previous = data.groups.back();
+                previous.indexCount = (unsigned int)data.indices.size() - previous.firstIndex;
+                if (previous.indexCount == 0) {
+                    data.groups.pop_back();
+                }
+            }
+            current.firstIndex = (unsigned int)data.indices.size();
+            data.groups.push_back(current);
+        };
+        startGroup();
+        auto pushVertex = [&](const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texture) {
+            data.vertices.insert(data.vertices.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z, texture.x, texture.y});
+            return (unsigned int)(data.getVertexCount() - 1);
+        };
+        for (Chunk& chunk : chunks) {
+            int positionOffset = (int)positions.size();
+            int textureOffset = (int)textures.size();
+            int normalOffset = (int)normals.size();
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            textures.insert(textures.end(), chunk.textures.begin(), chunk.textures.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            size_t nextEvent = 0;
+            size_t nTriangles = chunk.corners.size() / 3;
+            for (size_t triangle = 0; triangle <= nTriangles; ++triangle) {
+                for (; nextEvent < chunk.groupEvents.size() && chunk.groupEvents[nextEvent].triangle == triangle; ++nextEvent) {
+                    GroupEvent& event = chunk.groupEvents[nextEvent];
+                    if (event.kind == GroupKind::OBJECT) {
+                        current.object = std::move(event.name);
+                    }
+                    else if (event.kind == GroupKind::GROUP) {
+                        current.group = std::move(event.name);
+                    }
+                    else {
+                        current.material = std::move(event.name);
+                    }
+                    startGroup();
+                }
+                if (triangle == nTriangles) {
+                    break;
+                }
+                VertexKey keys[3];
+                bool bValid = true;
+                for (int i = 0; i < 3; ++i) {
+                    const Corner& corner = chunk.corners[3 * triangle + i];
+                    keys[i].v = corner.v + ((corner.flags & RELATIVE_POSITION) ? positionOffset : 0);
+                    keys[i].vt = (corner.flags & HAS_TEXTURE) ? corner.vt + ((corner.flags & RELATIVE_TEXTURE) ? textureOffset : 0) : -1;
+                    keys[i].vn = (corner.flags & HAS_NORMAL) ? corner.vn + ((corner.flags & RELATIVE_NORMAL) ? normalOffset : 0) : -1;
+                    bValid = bValid && keys[i].v >= 0 && keys[i].v < (int)positions.size()
+                        && keys[i].vt < (int)textures.size() && keys[i].vn < (int)normals.size()
+                        && ((corner.flags & HAS_TEXTURE) == 0 || keys[i].vt >= 0) && ((corner.flags & HAS_NORMAL) == 0 || keys[i].vn >= 0);
+                }
+                if (!bValid) {
+                    continue;
+                }
+                for (int i = 0; i < 3; ++i) {
+                    auto found = vertexIndices.find(keys[i]);
+                    if (found != vertexIndices.end()) {
+                        data.indices.push_back(found->second);
+                        continue;
+                    }
+                    glm::vec2 texture = keys[i].vt >= 0 ? textures[keys[i].vt] : glm::vec2(0.0f);
+                    //a zero normal is filled in later
+                    glm::vec3 normal = keys[i].vn >= 0 ? normals[keys[i].vn] : glm::vec3(0.0f);
+                    unsigned int index = pushVertex(positions[keys[i].v], normal, texture);
+                    vertexIndices.emplace(keys[i], index);
+                    data.indices.push_back(index);
+                }
+            }
+            //done with it, give the memory back before the next one grows the totals
+            chunk = Chunk{};
+        }
+        data.groups.back().indexCount = (unsigned int)data.indices.size() - data.groups.back().firstIndex;
+        if (data.groups.back().indexCount == 0) {
+            data.groups.pop_back();
+        }
+    }
+    
+    static bool sourceStamp(const std::string& path, uint64_t& size, int64_t& modified) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        size = (uint64_t)info.st_size;
+        modified = (int64_t)info.st_mtime;
+        return true;
+    }
+    
+    template <typename T>
+    static void write(std::ofstream& out, const T& value) {
+        out.write((const char*)&value, sizeof(T));
+    }
+    
+    template <typename T>
+    static bool read(std::ifstream& in, T& value) {
+        return (bool)in.read((char*)&value, sizeof(T));
+    }
+    
+    static void writeString(std::ofstream& out, const std::string& value) {
+        write(out, (uint32_t)value.size());
+        out.write(value.data(), value.size());
+    }
+    
+    static bool readString(std::ifstream& in, std::string& value) {
+        uint32_t length;
+        if (!read(in, length)) {
+            return false;
+        }
+        value.resize(length);
+        return (bool)in.read(value.data(), length);
+    }
+
+public:
+    
+    static std::string cachePath(const std::string& objFile) {
+        return objFile + ".pdkmesh";
+    }
+    
+    static bool parse(const std::string& objFile, ObjData& data) {
+        MappedFile file(objFile);
+        if (!file.isOpen()) {
+            return false;
+        }
+        std::vector<Chunk> chunks = split(file.data(), file.size());
+        ThreadPool::getInstance().parallelFor(0, (int)chunks.size(), 1, [&](int first, int last) {
+            for (int i = first; i < last; ++i) {
+                parseChunk(chunks[i]);
+            }
+        });
+        merge(chunks, data);
+        return true;
+    }
+    
+    /*
+     Layout: magic, version, the OBJ's size and modification time, the four counts, then the groups, the LODs,
+     the vertices and the indices, all native endian.
+     */
+    static bool writeCache(const std::string& objFile, const ObjData& data) {
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        if (!sourceStamp(objFile, sourceSize, sourceModified)) {
+            return false;
+        }
+        std::ofstream out(cachePath(objFile), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        write(out, CACHE_MAGIC);
+        write(out, CACHE_VERSION);
+        write(out, sourceSize);
+        write(out, sourceModified);
+        write(out, (uint64_t)data.vertices.size());
+        write(out, (uint64_t)data.indices.size());
+        write(out, (uint32_t)data.groups.size());
+        write(out, (uint32_t)data.lods.size());
+        for (const ObjGroup& group : data.groups) {
+            writeString(out, group.object);
+            writeString(out, group.group);
+            writeString(out, group.material);
+            write(out, group.firstIndex);
+            write(out, group.indexCount);
+        }
+        for (const MeshLod& lod : data.lods) {
+            write(out, lod.firstIndex);
+            write(out, lod.indexCount);
+            write(out, lod.error);
+        }
+        out.write((const char*)data.vertices.data(), data.vertices.size() * sizeof(float));
+        out.write((const char*)data.indices.data(), data.indices.size() * sizeof(unsigned int));
+        return (bool)out;
+    }
+    
+    //false if there's no cache or it's from another version of the OBJ (or of this format)
+    static bool readCache(const std::string& objFile, ObjData& data) {
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        if (!sourceStamp(objFile, sourceSize, sourceModified)) {
+            return false;
+        }
+        std::ifstream in(cachePath(objFile), std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        uint32_t magic, version, nGroups, nLods;
+        uint64_t cachedSize, nFloats, nIndices;
+        int64_t cachedModified;
+        if (!read(in, magic) || !read(in, version) || !read(in, cachedSize) || !read(in, cachedModified)
+            || magic != CACHE_MAGIC || version != CACHE_VERSION || cachedSize != sourceSize || cachedModified != sourceModified) {
+            return false;
+        }
+        if (!read(in, nFloats) || !read(in, nIndices) || !read(in, nGroups) || !read(in, nLods)) {
+            return false;
+        }
+        data.groups.resize(nGroups);
+        for (ObjGroup& group : data.groups) {
+            if (!readString(in, group.object) || !readString(in, group.group) || !readString(in, group.material)
+                || !read(in, group.firstIndex) || !read(in, group.indexCount)) {
+                return false;
+            }
+        }
+        data.lods.resize(nLods);
+        for (MeshLod& lod : data.lods) {
+            if (!read(in, lod.firstIndex) || !read(in, lod.indexCount) || !read(in, lod.error)) {
+                return false;
+            }
+        }
+        data.vertices.resize(nFloats);
+        data.indices.resize(nIndices);
+        return in.read((char*)data.vertices.data(), nFloats * sizeof(float))
+            && in.read((char*)data.indices.data(), nIndices * sizeof(unsigned int));
+    }
+    
+    //from the cache if it's current, otherwise parsed, optimized, simplified and cached for next time
+    static bool load(const std::string& objFile, ObjData& data) {
+        if (readCache(objFile, data)) {
+            size_t nFull = data.lods.empty() ? data.indices.size() : data.lods[0].indexCount;
+            std::cout << objFile << ": " << data.getVertexCount() << " vertices, ACMR " << MeshIndexer::computeACMR(data.indices.data(), nFull, data.getVertexCount()) << ", " << data.lods.size() << " LODs (cached)" << std::endl;
+            return true;
+        }
+        if (!parse(objFile, data)) {
+            return false;
+        }
+        std::vector<std::pair<unsigned int, unsigned int>> ranges{};
+        for (const ObjGroup& group : data.groups) {
+            ranges.emplace_back(group.firstIndex, group.indexCount);
+        }
+        MeshIndexer::Report report = MeshIndexer::optimize(data.vertices, data.indices, ranges);
+        //the parser has already shared corners, so "before" is indexed but unordered; the old glDrawArrays path
+        //was unindexed, a vertex and a vertex shader run for each of 3 corners a triangle
+        std::cout << objFile << ": " << report.triangles << " triangles, vertices " << report.triangles * 3 << " unindexed, " << report.verticesBefore << " parsed, " << report.verticesAfter << " welded; ACMR 3 unindexed, " << report.acmrBefore << " indexed, " << report.acmrAfter << " cache ordered" << std::endl;
+        data.lods = MeshSimplifier::buildLodChain(data.vertices, data.indices, ranges);
+        std::cout << "LODs:";
+        for (const MeshLod& lod : data.lods) {
+            std::cout << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+        }
+        std::cout << std::endl;
+        if (!writeCache(objFile, data)) {
+            std::cerr << "Failed to write the mesh cache for " << objFile << std::endl;
+        }
+        return true;
+    }
+};
+
+#endif /* objparser_h */
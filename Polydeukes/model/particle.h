@@ -27,6 +27,8 @@ private:
     float inverse_mass;
     glm::vec3 velocity = glm::vec3(0.0f);
     glm::vec3 force = glm::vec3(0.0f);
+    //how far the last step moved us, so the renderer can draw us part way between steps
+    glm::vec3 lastDisplacement = glm::vec3(0.0f);
     std::vector<std::function<void(Particle&, float deltaTime)>> tensors{};
     
     void updateForce(glm::vec3& force) {
@@ -43,6 +45,7 @@ public:
         this->shape = that.shape;
         inverse_mass = that.inverse_mass;
         velocity = that.velocity;
+        lastDisplacement = that.lastDisplacement;
         for (auto tensor : that.tensors) {
             tensors.push_back(tensor);
         }
@@ -71,9 +74,14 @@ public:
         velocity += glm::vec3(force.x * inverse_mass * deltaTime, force.y * inverse_mass * deltaTime, force.z * inverse_mass * deltaTime);
         glm::vec3 deltaPosition = glm::vec3(velocity.x * deltaTime, velocity.y * deltaTime, velocity.z * deltaTime);
         shape->translate(deltaPosition);
+        lastDisplacement = deltaPosition;
         force = glm::vec3(0.0f,0.0f,0.0f);
     }
     
+    glm::vec3 getLastDisplacement() const {
+        return lastDisplacement;
+    }
+    
     glm::vec3 getVelocity() const {
         return velocity;
     }
@@ -0,0 +1,422 @@
+//
+//  particlesystem.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef particlesystem_h
+#define particlesystem_h
+
+#include "shape.h"
+#include "simd.h"
+#include "threadpool.h"
+
+#include <glad/glad.h>
+#include <glm.hpp>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <limits>
+
+/*
+ Particle is one object per particle with its own shape and a list of std::function tensors, which is nice to
+ play with but tops out at a few thousand. ParticleSystem is the bulk version: every attribute lives in its own
+ contiguous float array (x's together, y's together, ...) so the integrator and the force kernels are straight
+ loops over memory that vectorize, and the positions can be handed to the GPU as is.
+ 
+ Integration is velocity Verlet:
+     x(t+dt)    = x + v dt + a dt^2 / 2
+     v(t+dt/2)  = v + a dt / 2
+     a(t+dt)    = F(x(t+dt), v(t+dt/2)) / m
+     v(t+dt)    = v(t+dt/2) + a(t+dt) dt / 2
+ Drag is velocity dependent so it sees the half step velocity, the usual compromise.
+ 
+ The forces are the same ones Particle has (Gravity, Drag, Spring) but applied as batched kernels over the whole
+ system rather than per particle callbacks. Gravity and drag apply to every particle; springs tie one particle
+ to a fixed anchor.
+ 
+ The step is split into chunks on the shared ThreadPool; the kernels don't care where a range starts, so each chunk
+ is just the same kernel on an offset pointer. Springs are few and can touch any particle so they run in between
+ the two passes on the calling thread.
+ 
+ Rendering draws the prototype shape once per particle. The x, y and z arrays are uploaded as three instance
+ attribute streams (particlevs.glsl) so there's no interleaving pass between the simulation and the GPU.
+ */
+class ParticleSystem : public Shape {
+private:
+    struct SpringData {
+        int index;
+        glm::vec3 anchor;
+        float springConstant;
+        float restingLength;
+    };
+    
+    //xyz position, velocity, acceleration (from the last step) and accumulated force, plus inverse mass
+    std::vector<float> px{}, py{}, pz{};
+    std::vector<float> vx{}, vy{}, vz{};
+    std::vector<float> ax{}, ay{}, az{};
+    std::vector<float> fx{}, fy{}, fz{};
+    std::vector<float> inverseMass{};
+    //positions before the last step and the blend of the two that gets drawn
+    std::vector<float> previousx{}, previousy{}, previousz{};
+    std::vector<float> renderx{}, rendery{}, renderz{};
+    float interpolation = 1.0f;
+    //what the current and previous positions span, kept up by step so getAABB (every frame, for the frustum)
+    //doesn't go over every particle again; rescanned only when bBoundsValid is off
+    glm::vec3 positionMin = glm::vec3(0.0f), positionMax = glm::vec3(0.0f);
+    glm::vec3 previousMin = glm::vec3(0.0f), previousMax = glm::vec3(0.0f);
+    bool bBoundsValid = false;
+    
+    glm::vec3 gravity = glm::vec3(0.0f);
+    float dragK1 = 0.0f;
+    float dragK2 = 0.0f;
+    std::vector<SpringData> springs{};
+    
+    std::shared_ptr<Shape> prototype;
+    unsigned int positionVBO[3]{};
+    size_t bufferCapacity = 0;
+    bool bInitialized = false;
+    
+    ParticleSystem(ParticleSystem& that) : Shape(that), px(that.px), py(that.py), pz(that.pz), vx(that.vx), vy(that.vy), vz(that.vz), ax(that.ax), ay(that.ay), az(that.az), fx(that.fx), fy(that.fy), fz(that.fz), inverseMass(that.inverseMass), previousx(that.previousx), previousy(that.previousy), previousz(that.previousz), interpolation(that.interpolation), positionMin(that.positionMin), positionMax(that.positionMax), previousMin(that.previousMin), previousMax(that.previousMax), bBoundsValid(that.bBoundsValid), gravity(that.gravity), dragK1(that.dragK1), dragK2(that.dragK2), springs(that.springs), prototype(that.prototype) {}
+    
+    //x += v dt + a dt^2/2, v += a dt/2, widening [lo, hi] to take in the new x's while they're in registers
+    static void driftKernel(float* x, float* v, const float* a, int n, float deltaTime, float& lo, float& hi) {
+        float halfDt = 0.5f * deltaTime;
+        float halfDtSquared = 0.5f * deltaTime * deltaTime;
+        //running bounds per lane, kept as plain floats so the full lanes and the tail share the same code
+        float lowest[simd::width];
+        float highest[simd::width];
+        std::fill(lowest, lowest + simd::width, lo);
+        std::fill(highest, highest + simd::width, hi);
+        simd::forEach(n, [&](int i, auto lane) {
+            auto position = simd::load(x + i, lane);
+            auto velocity = simd::load(v + i, lane);
+            auto acceleration = simd::load(a + i, lane);
+            position = simd::add(position, simd::add(simd::mul(velocity, simd::set(deltaTime, lane)), simd::mul(acceleration, simd::set(halfDtSquared, lane))));
+            velocity = simd::add(velocity, simd::mul(acceleration, simd::set(halfDt, lane)));
+            simd::store(x + i, position);
+            simd::store(v + i, velocity);
+            simd::store(lowest, simd::min(simd::load(lowest, lane), position));
+            simd::store(highest, simd::max(simd::load(highest, lane), position));
+        });
+        lo = *std::min_element(lowest, lowest + simd::width);
+        hi = *std::max_element(highest, highest + simd::width);
+    }
+    
+    //a = f / m, v += a dt/2, then clear the force for the next step
+    static void kickKernel(float* v, float* a, float* f, const float* inverseMass, int n, float deltaTime) {
+        float halfDt = 0.5f * deltaTime;
+        simd::forEach(n, [&](int i, auto lane) {
+            auto acceleration = simd::mul(simd::load(f + i, lane), simd::load(inverseMass + i, lane));
+            auto velocity = simd::add(simd::load(v + i, lane), simd::mul(acceleration, simd::set(halfDt, lane)));
+            simd::store(a + i, acceleration);
+            simd::store(v + i, velocity);
+            simd::store(f + i, simd::set(0.0f, lane));
+        });
+    }
+    
+    static void constantForceKernel(float* f, float force, int n) {
+        if (force == 0.0f) {
+            return;
+        }
+        simd::forEach(n, [&](int i, auto lane) {
+            simd::store(f + i, simd::add(simd::load(f + i, lane), simd::set(force, lane)));
+        });
+    }
+    
+    /*
+     Same quadratic drag as Drag, -(k1|v| + k2|v|^2) v/|v|, written as -(k1 + k2|v|) v so there's no divide
+     and no special case for particles at rest.
+     */
+    static void dragKernel(float* fx, float* fy, float* fz, const float* vx, const float* vy, const float* vz, int n, float k1, float k2) {
+        simd::forEach(n, [&](int i, auto lane) {
+            auto x = simd::load(vx + i, lane);
+            auto y = simd::load(vy + i, lane);
+            auto z = simd::load(vz + i, lane);
+            auto speed = simd::sqrt(simd::add(simd::mul(x, x), simd::add(simd::mul(y, y), simd::mul(z, z))));
+            auto coefficient = simd::sub(simd::set(0.0f, lane), simd::add(simd::set(k1, lane), simd::mul(simd::set(k2, lane), speed)));
+            simd::store(fx + i, simd::add(simd::load(fx + i, lane), simd::mul(x, coefficient)));
+            simd::store(fy + i, simd::add(simd::load(fy + i, lane), simd::mul(y, coefficient)));
+            simd::store(fz + i, simd::add(simd::load(fz + i, lane), simd::mul(z, coefficient)));
+        });
+    }
+    
+    //springs are sparse (one particle each), so a plain gather loop
+    void springKernel() {
+        for (auto& spring : springs) {
+            glm::vec3 delta = glm::vec3(px[spring.index], py[spring.index], pz[spring.index]) - spring.anchor;
+            float length = glm::length(delta);
+            if (length < 1e-6f) {
+                continue;
+            }
+            glm::vec3 force = (-1.0f * spring.springConstant * (length - spring.restingLength) / length) * delta;
+            fx[spring.index] += force.x;
+            fy[spring.index] += force.y;
+            fz[spring.index] += force.z;
+        }
+    }
+    
+    //the per particle forces for [begin, end), springs are done separately
+    void accumulateForces(int begin, int end) {
+        int n = end - begin;
+        constantForceKernel(fx.data() + begin, gravity.x, n);
+        constantForceKernel(fy.data() + begin, gravity.y, n);
+        constantForceKernel(fz.data() + begin, gravity.z, n);
+        if (dragK1 != 0.0f || dragK2 != 0.0f) {
+            dragKernel(fx.data() + begin, fy.data() + begin, fz.data() + begin, vx.data() + begin, vy.data() + begin, vz.data() + begin, n, dragK1, dragK2);
+        }
+    }
+    
+    std::vector<std::vector<float>*> attributes() {
+        return {&px, &py, &pz, &vx, &vy, &vz, &ax, &ay, &az, &fx, &fy, &fz, &inverseMass, &previousx, &previousy, &previousz};
+    }
+    
+    //blend of the previous and current positions, x_prev + alpha (x - x_prev)
+    static void interpolateKernel(float* out, const float* previous, const float* current, int n, float alpha) {
+        simd::forEach(n, [&](int i, auto lane) {
+            auto from = simd::load(previous + i, lane);
+            auto delta = simd::sub(simd::load(current + i, lane), from);
+            simd::store(out + i, simd::add(from, simd::mul(delta, simd::set(alpha, lane))));
+        });
+    }
+    
+    //the slow way, for when particles have been added or taken out since the last step
+    void computeBounds() {
+        positionMin = glm::vec3(*std::min_element(px.begin(), px.end()), *std::min_element(py.begin(), py.end()), *std::min_element(pz.begin(), pz.end()));
+        positionMax = glm::vec3(*std::max_element(px.begin(), px.end()), *std::max_element(py.begin(), py.end()), *std::max_element(pz.begin(), pz.end()));
+        previousMin = glm::min(positionMin, glm::vec3(*std::min_element(previousx.begin(), previousx.end()), *std::min_element(previousy.begin(), previousy.end()), *std::min_element(previousz.begin(), previousz.end())));
+        previousMax = glm::max(positionMax, glm::vec3(*std::max_element(previousx.begin(), previousx.end()), *std::max_element(previousy.begin(), previousy.end()), *std::max_element(previousz.begin(), previousz.end())));
+        bBoundsValid = true;
+    }
+    
+    void init() {
+        glGenBuffers(3, positionVBO);
+        bInitialized = true;
+    }
+    
+    void upload() {
+        //orphan and refill, the whole array changes every step anyway
+        bufferCapacity = std::max(bufferCapacity, size());
+        const std::vector<float>* streams[3] = {&px, &py, &pz};
+        if (interpolation < 1.0f) {
+            renderx.resize(size());
+            rendery.resize(size());
+            renderz.resize(size());
+            ThreadPool::getInstance().parallelFor(0, (int)size(), GRAIN, [&](int begin, int end) {
+                interpolateKernel(renderx.data() + begin, previousx.data() + begin, px.data() + begin, end - begin, interpolation);
+                interpolateKernel(rendery.data() + begin, previousy.data() + begin, py.data() + begin, end - begin, interpolation);
+                interpolateKernel(renderz.data() + begin, previousz.data() + begin, pz.data() + begin, end - begin, interpolation);
+            });
+            streams[0] = &renderx;
+            streams[1] = &rendery;
+            streams[2] = &renderz;
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            glBindBuffer(GL_ARRAY_BUFFER, positionVBO[axis]);
+            glBufferData(GL_ARRAY_BUFFER, bufferCapacity * sizeof(float), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size() * sizeof(float), streams[axis]->data());
+        }
+    }
+
+public:
+    
+    static constexpr unsigned int POSITION_LOCATION = 3;
+    //particles per chunk handed to the pool, big enough that a chunk outweighs the cost of queueing it
+    static constexpr int GRAIN = 16384;
+    
+    explicit ParticleSystem(std::shared_ptr<Shape> prototype) : prototype(prototype) {}
+    
+    virtual ~ParticleSystem() {
+        if (bInitialized) {
+            glDeleteBuffers(3, positionVBO);
+        }
+    }
+    
+    int addParticle(glm::vec3 position, float inverseMass, glm::vec3 velocity = glm::vec3(0.0f)) {
+        px.push_back(position.x); py.push_back(position.y); pz.push_back(position.z);
+        vx.push_back(velocity.x); vy.push_back(velocity.y); vz.push_back(velocity.z);
+        ax.push_back(0.0f); ay.push_back(0.0f); az.push_back(0.0f);
+        fx.push_back(0.0f); fy.push_back(0.0f); fz.push_back(0.0f);
+        this->inverseMass.push_back(inverseMass);
+        previousx.push_back(position.x); previousy.push_back(position.y); previousz.push_back(position.z);
+        if (bBoundsValid) {
+            positionMin = glm::min(positionMin, position); positionMax = glm::max(positionMax, position);
+            previousMin = glm::min(previousMin, position); previousMax = glm::max(previousMax, position);
+        }
+        return (int)size() - 1;
+    }
+    
+    void reserve(size_t n) {
+        for (auto* attribute : attributes()) {
+            attribute->reserve(n);
+        }
+    }
+    
+    size_t size() const {
+        return px.size();
+    }
+    
+    glm::vec3 getParticlePosition(int index) const {
+        return glm::vec3(px[index], py[index], pz[index]);
+    }
+    
+    glm::vec3 getParticleVelocity(int index) const {
+        return glm::vec3(vx[index], vy[index], vz[index]);
+    }
+    
+    //Gravity applies a constant force of (0,-30,0), same default here
+    void setGravity(glm::vec3 force = glm::vec3(0.0f, -30.0f, 0.0f)) {
+        gravity = force;
+    }
+    
+    void setDrag(float k1, float k2) {
+        dragK1 = k1;
+        dragK2 = k2;
+    }
+    
+    void addSpring(int index, glm::vec3 anchor, float springConstant, float restingLength) {
+        springs.push_back({index, anchor, springConstant, restingLength});
+    }
+    
+    /*
+     One velocity Verlet step. The first step after adding a particle uses a zero acceleration for the drift,
+     which is the same thing Euler would do for that step.
+     */
+    void step(float deltaTime) {
+        if (size() == 0) {
+            return;
+        }
+        if (!bBoundsValid) {
+            computeBounds();
+        }
+        //the positions about to become the previous ones
+        previousMin = positionMin;
+        previousMax = positionMax;
+        glm::vec3 newMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 newMax = glm::vec3(std::numeric_limits<float>::lowest());
+        std::mutex boundsMutex;
+        ThreadPool& pool = ThreadPool::getInstance();
+        pool.parallelFor(0, (int)size(), GRAIN, [&](int begin, int end) {
+            int n = end - begin;
+            std::copy(px.begin() + begin, px.begin() + end, previousx.begin() + begin);
+            std::copy(py.begin() + begin, py.begin() + end, previousy.begin() + begin);
+            std::copy(pz.begin() + begin, pz.begin() + end, previousz.begin() + begin);
+            glm::vec3 chunkMin = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 chunkMax = glm::vec3(std::numeric_limits<float>::lowest());
+            driftKernel(px.data() + begin, vx.data() + begin, ax.data() + begin, n, deltaTime, chunkMin.x, chunkMax.x);
+            driftKernel(py.data() + begin, vy.data() + begin, ay.data() + begin, n, deltaTime, chunkMin.y, chunkMax.y);
+            driftKernel(pz.data() + begin, vz.data() + begin, az.data() + begin, n, deltaTime, chunkMin.z, chunkMax.z);
+            accumulateForces(begin, end);
+            std::lock_guard<std::mutex> lock(boundsMutex);
+            newMin = glm::min(newMin, chunkMin);
+            newMax = glm::max(newMax, chunkMax);
+        });
+        positionMin = newMin;
+        positionMax = newMax;
+        springKernel();
+        pool.parallelFor(0, (int)size(), GRAIN, [&](int begin, int end) {
+            int n = end - begin;
+            kickKernel(vx.data() + begin, ax.data() + begin, fx.data() + begin, inverseMass.data() + begin, n, deltaTime);
+            kickKernel(vy.data() + begin, ay.data() + begin, fy.data() + begin, inverseMass.data() + begin, n, deltaTime);
+            kickKernel(vz.data() + begin, az.data() + begin, fz.data() + begin, inverseMass.data() + begin, n, deltaTime);
+        });
+    }
+    
+    /*
+     Where between the previous step (0) and the current one (1) to draw the particles, for when the physics runs
+     on a fixed timestep that doesn't line up with the frames.
+     */
+    void setInterpolation(float alpha) {
+        interpolation = std::min(std::max(alpha, 0.0f), 1.0f);
+    }
+    
+    /*
+     Same idea as Renderer::isOutsideBoundary. Swaps the escaped particle with the last one, so indices (and springs
+     on moved particles) aren't stable across a call; springs on removed particles are dropped.
+     */
+    void removeOutside(float radius) {
+        float radiusSquared = radius * radius;
+        for (int i = 0; i < (int)size();) {
+            if (px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i] <= radiusSquared) {
+                ++i;
+                continue;
+            }
+            int last = (int)size() - 1;
+            for (auto* attribute : attributes()) {
+                (*attribute)[i] = (*attribute)[last];
+                attribute->pop_back();
+            }
+            springs.erase(std::remove_if(springs.begin(), springs.end(), [&](SpringData& spring) { return spring.index == i; }), springs.end());
+            bBoundsValid = false;
+            for (auto& spring : springs) {
+                if (spring.index == last) {
+                    spring.index = i;
+                }
+            }
+        }
+    }
+    
+    unsigned int getVAO() const override {
+        return prototype->getVAO();
+    }
+    
+    unsigned int getTexture() const override {
+        return prototype->getTexture();
+    }
+    
+    void render(ShaderProgram& shaderProgram) override {
+        if (size() == 0) {
+            return;
+        }
+        if (!bInitialized) {
+            init();
+        }
+        upload();
+        shaderProgram.set(shaderProgram.model, prototype->getModellingTransform());
+        shaderProgram.set(shaderProgram.colour, colour);
+        glBindVertexArray(prototype->getVAO());
+        for (unsigned int axis = 0; axis < 3; ++axis) {
+            glBindBuffer(GL_ARRAY_BUFFER, positionVBO[axis]);
+            glVertexAttribPointer(POSITION_LOCATION + axis, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+            glEnableVertexAttribArray(POSITION_LOCATION + axis);
+            glVertexAttribDivisor(POSITION_LOCATION + axis, 1);
+        }
+        prototype->renderInstanced(shaderProgram, (int)size());
+        for (unsigned int axis = 0; axis < 3; ++axis) {
+            glVertexAttribDivisor(POSITION_LOCATION + axis, 0);
+            glDisableVertexAttribArray(POSITION_LOCATION + axis);
+        }
+    }
+    
+    //not pickable, a hundred thousand ids for a fountain isn't worth the fill
+    void renderID(ShaderProgram& shaderProgram) override {}
+    
+    std::vector<glm::vec3> getAABB() override {
+        if (size() == 0) {
+            return std::vector<glm::vec3>({glm::vec3(0.0f,0.0f,0.0f)});
+        }
+        if (!bBoundsValid) {
+            computeBounds();
+        }
+        //drawn somewhere between the previous positions and these
+        glm::vec3 min = interpolation < 1.0f ? glm::min(positionMin, previousMin) : positionMin;
+        glm::vec3 max = interpolation < 1.0f ? glm::max(positionMax, previousMax) : positionMax;
+        std::vector<glm::vec3> prototypeAABB = prototype->getAABB();
+        if (prototypeAABB.size() > 1) {
+            min += prototypeAABB[0];
+            max += prototypeAABB[1];
+        }
+        return Shape::padAABB(min, max);
+    }
+    
+    std::shared_ptr<Shape> clone() override {
+        auto retval = std::shared_ptr<ParticleSystem>(new ParticleSystem(*this));
+        retval->referenceToThis = retval;
+        return retval;
+    }
+
+};
+
+#endif /* particlesystem_h */
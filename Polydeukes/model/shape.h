@@ -13,15 +13,16 @@
 #include <vector>
 #include "clickable.h"
 #include "mesh.h"
+#include "frustum.h"
 #include "texture.h"
 #include "ShaderProgram.h"
 #include <glad/glad.h>
 
+#include <cassert>
 #include <limits>
 #include <memory>
 
 class ShaderProgram;
-class SceneListNode;
 
 
 /*
@@ -39,10 +40,10 @@ class SceneListNode;
  */
 
 class ShapeBuilder;
+class AssetStreamer;
 
 class Shape : public Clickable<Shape> {
     friend ShapeBuilder;
-    friend SceneListNode;
 private:
     static int n_freed_shapes;
 protected:
@@ -53,6 +54,9 @@ protected:
     bool bInitializedAABB = false;
     unsigned int AABBVAO, AABBEBO, AABBVBO;
     std::weak_ptr<Shape> referenceToThis;
+    //world AABB derived from the mesh's local bounds, valid while aabbVersion matches the mesh
+    std::vector<glm::vec3> cachedAABB{};
+    unsigned long aabbVersion = std::numeric_limits<unsigned long>::max();
   
 public:
     
@@ -72,11 +76,57 @@ public:
         return glm::vec3(tmp.x,tmp.y,tmp.z);
     }
     
-    virtual void render(ShaderProgram shaderProgram) = 0;
+    virtual void render(ShaderProgram& shaderProgram) = 0;
+    
+    /*
+     Draw just the coverage for the GPU picker (see PickingBuffer); the program's id uniform is already set.
+     Plain shapes render as normal, anything whose render has side effects or binds its own program overrides this.
+     */
+    virtual void renderID(ShaderProgram& shaderProgram) {
+        render(shaderProgram);
+    }
+    
+    /*
+     Frustum culling inside composite shapes. The renderer calls this when the shape's own box is partly in view
+     (PARTIAL) or wholly in it (INSIDE, nothing to cull), and parts found to be outside are left out of the next
+     render. Returns how many parts were culled.
+     */
+    virtual int cullParts(const Frustum& frustum, Containment containment) {
+        return 0;
+    }
+    
+    /*
+     Called by the renderer every frame just before render with the frame's matrices and the viewport height in
+     pixels, so shapes can work out what to draw from this view (ArbitraryShape picks a level of detail for how
+     big it is on screen and culls its meshlets).
+     */
+    virtual void updateView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    }
+    
+    /*
+     The renderer sorts its queue on (program, vao, texture) so adjacent draws share as much state as possible.
+     Shapes that own a single VAO should report it; 0 means "no preference" and just sorts to the front.
+     */
+    virtual unsigned int getVAO() const {
+        return 0;
+    }
+    
+    virtual unsigned int getTexture() const {
+        return texture;
+    }
+    
+    /*
+     Draw nInstances copies of this shape's geometry in one call. The model matrix and colour come from
+     per-instance attributes (see InstancedBatch) rather than uniforms, so only shapes with a shared VAO make sense here.
+     Shapes that don't override it have nowhere to read those attributes from, so asking one to is a bug.
+     */
+    virtual void renderInstanced(ShaderProgram& shaderProgram, int nInstances) {
+        assert(!"renderInstanced called on a shape that doesn't support instancing");
+    }
     
     //TODO: Optimize based on probably sharing the VAO reference or smarter aabb calculation
     //Probably can just upload the aabb of a preloaded mesh as soon as it's instantiated. then just apply the modeling transform to it.
-    void renderAABB(std::vector<glm::vec3> aabb, ShaderProgram program) {
+    void renderAABB(std::vector<glm::vec3> aabb, ShaderProgram& program) {
         if (!bInitializedAABB) {
             glGenVertexArrays(1, &AABBVAO);
             glGenBuffers(1, &AABBEBO);
@@ -134,15 +184,13 @@ public:
     }
     
     virtual void setModelingTransform(glm::mat4&& transform) {
-        //there is no memory allocated for the model position, it is just world, so we get back to the model position (origin) like this
-        glm::mat4 meshTransform = transform * glm::inverse(modellingTransform);
-        mesh.updatePosition(meshTransform);
+        //the mesh keeps its vertices in model space, so it only needs to know the new transform
+        mesh.setTransform(transform);
         modellingTransform = transform;
     }
     
     virtual void setModelingTransform(glm::mat4& transform) {
-        glm::mat4 meshTransform = transform * glm::inverse(modellingTransform);
-        mesh.updatePosition(meshTransform);
+        mesh.setTransform(transform);
         modellingTransform = transform;
     }
     
@@ -159,7 +207,7 @@ public:
     }
     
     Shape(const Shape& that) {
-        this->mesh = Mesh(that.mesh);
+        this->mesh = that.mesh;
         this->modellingTransform = that.modellingTransform;
         this->colour = that.colour;
         this->texture = that.texture;
@@ -195,18 +243,89 @@ public:
      To match the rest of the "customization over implementation" idea for these shapes, we need this to compute an AABB
      For any mesh. In fact, maybe the shape class is more a particle class, cause some shapes may not be clickable, e.g....
      Either way, we want compile time customization for generic shapes... back to the mesh's have aabb data idea
+     
+     The mesh carries its model space bounds, so the world box is just those bounds pushed through the modelling
+     transform (Arvo's method), recomputed only when the mesh's transform version moves. It's conservative under
+     rotation compared to scanning the world positions, which is fine for picking and collision broadphase.
      */
     virtual std::vector<glm::vec3> getAABB() {
-        std::vector<glm::vec3> positions = mesh.getPosition();
-        return Shape::computeAABB(positions);
+        if (mesh.size() == 0) {
+            return std::vector<glm::vec3>({glm::vec3(0.0f,0.0f,0.0f)});
+        }
+        if (aabbVersion != mesh.getVersion()) {
+            cachedAABB = Shape::transformAABB(mesh.getLocalMin(), mesh.getLocalMax(), mesh.getTransform());
+            aabbVersion = mesh.getVersion();
+        }
+        return cachedAABB;
+    }
+    
+    /*
+     Arvo, "Transforming Axis-Aligned Bounding Boxes" (Graphics Gems, 1990): each output extent is the translation
+     plus, per input axis, whichever of the min/max products is smaller (or larger).
+     */
+    static std::vector<glm::vec3> transformAABB(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform) {
+        glm::vec3 worldMin = glm::vec3(transform[3]);
+        glm::vec3 worldMax = worldMin;
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                float a = transform[column][row] * localMin[column];
+                float b = transform[column][row] * localMax[column];
+                worldMin[row] += std::min(a, b);
+                worldMax[row] += std::max(a, b);
+            }
+        }
+        return padAABB(worldMin, worldMax);
+    }
+    
+    //flat shapes (squares, glyph quads) still need some thickness to be hit
+    static std::vector<glm::vec3> padAABB(glm::vec3 min, glm::vec3 max) {
+        if (std::abs(min.x - max.x) < 0.1) max.x += 0.1f;
+        if (std::abs(min.y - max.y) < 0.1) max.y += 0.1f;
+        if (std::abs(min.z - max.z) < 0.1) max.z += 0.1f;
+        return std::vector<glm::vec3>({min, max});
+    }
+    
+    //union of boxes as returned by getAABB, skipping the single point "empty" boxes
+    static std::vector<glm::vec3> mergeAABB(const std::vector<glm::vec3>& aabb1, const std::vector<glm::vec3>& aabb2) {
+        if (aabb1.size() < 2) {
+            return aabb2;
+        }
+        if (aabb2.size() < 2) {
+            return aabb1;
+        }
+        return std::vector<glm::vec3>({glm::min(aabb1[0], aabb2[0]), glm::max(aabb1[1], aabb2[1])});
     }
     
     virtual std::vector<glm::vec3> getPositions() {
-        std::vector<glm::vec3> positions = mesh.getPosition();
-        return positions;
+        return mesh.getPosition();
+    }
+    
+    //copying it is cheap (the vertices are shared), e.g. to hand a snapshot to a background job
+    const Mesh& getMesh() const {
+        return mesh;
     }
     
-    static std::vector<glm::vec3> computeAABB(std::vector<glm::vec3>& positions) {
+    /*
+     Nearest hit of a world space ray on this shape, if it's closer than hit.t. The ray goes into model space
+     rather than the vertices coming out; the direction isn't renormalized so t means the same thing in both.
+     Composite shapes override this to ask their parts.
+     */
+    virtual bool intersectRay(const Ray& ray, RayHit& hit) {
+        if (mesh.getTriangleCount() == 0) {
+            return false;
+        }
+        glm::mat4 toModelSpace = glm::inverse(mesh.getTransform());
+        glm::vec4 origin = toModelSpace * glm::vec4(ray.origin, 1.0f);
+        glm::vec4 direction = toModelSpace * glm::vec4(ray.direction, 0.0f);
+        Ray modelSpaceRay{glm::vec3(origin.x, origin.y, origin.z), glm::vec3(direction.x, direction.y, direction.z)};
+        if (!mesh.intersect(modelSpaceRay, hit)) {
+            return false;
+        }
+        hit.position = ray.origin + ray.direction * hit.t;
+        return true;
+    }
+    
+    static std::vector<glm::vec3> computeAABB(const std::vector<glm::vec3>& positions) {
         if (positions.size() == 0) {
             return std::vector<glm::vec3>({glm::vec3(0.0f,0.0f,0.0f)});
         }
@@ -223,14 +342,7 @@ public:
             if (pos.z > maxz) maxz = pos.z;
         }
 
-        if (std::abs(minx - maxx) < 0.1) maxx += 0.1f;
-        if (std::abs(miny - maxy) < 0.1) maxy += 0.1f;
-        if (std::abs(minz - maxz) < 0.1) maxz += 0.1f;
-
-        std::vector<glm::vec3> aabb;
-        aabb.push_back(glm::vec3(minx, miny, minz));
-        aabb.push_back(glm::vec3(maxx, maxy, maxz));
-        return aabb;
+        return padAABB(glm::vec3(minx, miny, minz), glm::vec3(maxx, maxy, maxz));
     }
     
     virtual void setColour(glm::vec3 colour) {
@@ -246,7 +358,7 @@ public:
      */
     virtual void translate(glm::mat4& translation) {
         modellingTransform = translation * modellingTransform;
-        mesh.updatePosition(translation);
+        mesh.setTransform(modellingTransform);
     }
     
     void translate(glm::vec3& position) {
@@ -266,8 +378,12 @@ private:
 protected:
     std::shared_ptr<Shape> shape{};
 public:
-    ShapeBuilder& withTexture(std::string&& texture_path) {
-        shape->texture = texture::generateTexture(texture_path);
+    //decoded on the pool and sent up by the streamer (the renderer's), grey until then; defined in assetstreamer.h
+    ShapeBuilder& withTexture(AssetStreamer& streamer, const std::string& texturePath);
+    
+    //an already made texture, e.g. one still streaming in from AssetStreamer::loadTexture
+    ShapeBuilder& withTexture(unsigned int texture) {
+        shape->texture = texture;
         return *this;
     }
     
@@ -0,0 +1,134 @@
+//
+//  simd.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef simd_h
+#define simd_h
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+ Just enough of a vector float type to write the hot loops once. Intel macs get AVX (or SSE2), Apple silicon
+ gets NEON, anything else falls back to plain floats. Every op also has a scalar overload so a kernel can be
+ written as a generic lambda and run over full lanes first and then the leftover tail with the same code:
+     
+     simd::forEach(n, [&](int i, auto lane) {
+         auto x = simd::load(xs + i, lane);
+         simd::store(xs + i, simd::add(x, simd::set(1.0f, lane)));
+     });
+ */
+namespace simd {
+
+#if defined(__AVX__)
+    typedef __m256 floats;
+    constexpr int width = 8;
+    inline floats load(const float* p, floats) { return _mm256_loadu_ps(p); }
+    inline void store(float* p, floats v) { _mm256_storeu_ps(p, v); }
+    inline floats set(float f, floats) { return _mm256_set1_ps(f); }
+    inline floats add(floats a, floats b) { return _mm256_add_ps(a, b); }
+    inline floats sub(floats a, floats b) { return _mm256_sub_ps(a, b); }
+    inline floats mul(floats a, floats b) { return _mm256_mul_ps(a, b); }
+    inline floats div(floats a, floats b) { return _mm256_div_ps(a, b); }
+    inline floats min(floats a, floats b) { return _mm256_min_ps(a, b); }
+    inline floats max(floats a, floats b) { return _mm256_max_ps(a, b); }
+    inline floats sqrt(floats a) { return _mm256_sqrt_ps(a); }
+    inline floats less(floats a, floats b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline floats lessEqual(floats a, floats b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    inline floats bitAnd(floats a, floats b) { return _mm256_and_ps(a, b); }
+    inline floats bitOr(floats a, floats b) { return _mm256_or_ps(a, b); }
+    inline floats select(floats mask, floats a, floats b) { return _mm256_blendv_ps(b, a, mask); }
+#elif defined(__SSE2__)
+    typedef __m128 floats;
+    constexpr int width = 4;
+    inline floats load(const float* p, floats) { return _mm_loadu_ps(p); }
+    inline void store(float* p, floats v) { _mm_storeu_ps(p, v); }
+    inline floats set(float f, floats) { return _mm_set1_ps(f); }
+    inline floats add(floats a, floats b) { return _mm_add_ps(a, b); }
+    inline floats sub(floats a, floats b) { return _mm_sub_ps(a, b); }
+    inline floats mul(floats a, floats b) { return _mm_mul_ps(a, b); }
+    inline floats div(floats a, floats b) { return _mm_div_ps(a, b); }
+    inline floats min(floats a, floats b) { return _mm_min_ps(a, b); }
+    inline floats max(floats a, floats b) { return _mm_max_ps(a, b); }
+    inline floats sqrt(floats a) { return _mm_sqrt_ps(a); }
+    inline floats less(floats a, floats b) { return _mm_cmplt_ps(a, b); }
+    inline floats lessEqual(floats a, floats b) { return _mm_cmple_ps(a, b); }
+    inline floats bitAnd(floats a, floats b) { return _mm_and_ps(a, b); }
+    inline floats bitOr(floats a, floats b) { return _mm_or_ps(a, b); }
+    inline floats select(floats mask, floats a, floats b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    typedef float32x4_t floats;
+    constexpr int width = 4;
+    inline floats load(const float* p, floats) { return vld1q_f32(p); }
+    inline void store(float* p, floats v) { vst1q_f32(p, v); }
+    inline floats set(float f, floats) { return vdupq_n_f32(f); }
+    inline floats add(floats a, floats b) { return vaddq_f32(a, b); }
+    inline floats sub(floats a, floats b) { return vsubq_f32(a, b); }
+    inline floats mul(floats a, floats b) { return vmulq_f32(a, b); }
+    inline floats div(floats a, floats b) { return vdivq_f32(a, b); }
+    inline floats min(floats a, floats b) { return vminq_f32(a, b); }
+    inline floats max(floats a, floats b) { return vmaxq_f32(a, b); }
+    inline floats sqrt(floats a) { return vsqrtq_f32(a); }
+    inline floats less(floats a, floats b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+    inline floats lessEqual(floats a, floats b) { return vreinterpretq_f32_u32(vcleq_f32(a, b)); }
+    inline floats bitAnd(floats a, floats b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+    inline floats bitOr(floats a, floats b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+    inline floats select(floats mask, floats a, floats b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+#else
+    typedef float floats;
+    constexpr int width = 1;
+#endif
+    
+    //scalar lane, used for the tail (and for everything when there's no vector unit)
+    inline float load(const float* p, float) { return *p; }
+    inline void store(float* p, float v) { *p = v; }
+    inline float set(float f, float) { return f; }
+    inline float add(float a, float b) { return a + b; }
+    inline float sub(float a, float b) { return a - b; }
+    inline float mul(float a, float b) { return a * b; }
+    inline float div(float a, float b) { return a / b; }
+    inline float min(float a, float b) { return std::min(a, b); }
+    inline float max(float a, float b) { return std::max(a, b); }
+    inline float sqrt(float a) { return std::sqrt(a); }
+    
+    //comparisons give a mask, all ones in the lanes where they hold (a bool for the scalar lane), for select
+    inline bool less(float a, float b) { return a < b; }
+    inline bool lessEqual(float a, float b) { return a <= b; }
+    inline bool bitAnd(bool a, bool b) { return a && b; }
+    inline bool bitOr(bool a, bool b) { return a || b; }
+    inline float select(bool mask, float a, float b) { return mask ? a : b; }
+    
+    //number of floats in a lane, for stepping through one after a store
+    template <typename Lane>
+    constexpr int lanes() { return sizeof(Lane) / sizeof(float); }
+    
+    /*
+     Calls body(i, floats{}) for each full lane starting at i, then body(i, float{}) for the remainder.
+     */
+    template <typename Body>
+    inline void forEach(int n, Body&& body) {
+        int i = 0;
+        if (width > 1) {
+            for (; i + width <= n; i += width) {
+                body(i, floats{});
+            }
+        }
+        for (; i < n; ++i) {
+            body(i, float{});
+        }
+    }
+
+}
+
+#endif /* simd_h */
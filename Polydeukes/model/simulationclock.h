@@ -0,0 +1,123 @@
+//
+//  simulationclock.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef simulationclock_h
+#define simulationclock_h
+
+#include <cmath>
+#include <algorithm>
+
+/*
+ The one clock physics and animation run off. Real time (scaled) goes into an accumulator and comes out as
+ whole fixed steps, so the simulation advances the same way however fast or slow the frames are
+ (https://gafferongames.com/post/fix_your_timestep/).
+ 
+ A frame is drawn somewhere between the last two steps. getInterpolation is how far (0-1) past the previous
+ step we are, and getRenderTime is the simulated time that corresponds to, which is what the animation samples.
+ 
+ maxSubsteps caps the catch-up work in one frame so a slow frame can't snowball into a slower one; the time that
+ doesn't fit is dropped (the simulation runs slow rather than freezing). Turn the time scale up (and the cap
+ with it) to run faster than real time, e.g. for batch runs.
+ */
+class SimulationClock {
+private:
+    double fixedStep;
+    int maxSubsteps = 8;
+    double timeScale = 1.0;
+    double accumulator = 0.0;
+    double simulatedTime = 0.0;
+    long nSteps = 0;
+    long nDroppedSteps = 0;
+    bool bPaused = false;
+
+public:
+    
+    explicit SimulationClock(double fixedStep = 1.0 / 60.0) : fixedStep(fixedStep) {}
+    
+    /*
+     Feeds in realSeconds of wall time and calls step(fixedStep) for every whole step that's due, at most
+     maxSubsteps times. Returns the number of steps taken.
+     */
+    template <typename Step>
+    int advance(double realSeconds, Step&& step) {
+        if (bPaused) {
+            return 0;
+        }
+        accumulator += std::max(realSeconds, 0.0) * timeScale;
+        int nSubsteps = 0;
+        while (accumulator >= fixedStep && nSubsteps < maxSubsteps) {
+            step((float)fixedStep);
+            accumulator -= fixedStep;
+            simulatedTime += fixedStep;
+            ++nSubsteps;
+            ++nSteps;
+        }
+        if (accumulator >= fixedStep) {
+            nDroppedSteps += (long)(accumulator / fixedStep);
+            accumulator = std::fmod(accumulator, fixedStep);
+        }
+        return nSubsteps;
+    }
+    
+    float getInterpolation() const {
+        return (float)(accumulator / fixedStep);
+    }
+    
+    //simulated time of the latest step
+    double getTime() const {
+        return simulatedTime;
+    }
+    
+    //simulated time of what's on screen, between the last two steps
+    double getRenderTime() const {
+        return std::max(0.0, simulatedTime - fixedStep + accumulator);
+    }
+    
+    double getFixedStep() const {
+        return fixedStep;
+    }
+    
+    void setFixedStep(double fixedStep) {
+        this->fixedStep = fixedStep;
+    }
+    
+    int getMaxSubsteps() const {
+        return maxSubsteps;
+    }
+    
+    void setMaxSubsteps(int maxSubsteps) {
+        this->maxSubsteps = std::max(1, maxSubsteps);
+    }
+    
+    double getTimeScale() const {
+        return timeScale;
+    }
+    
+    void setTimeScale(double timeScale) {
+        this->timeScale = std::max(0.0, timeScale);
+    }
+    
+    void setPaused(bool bPaused) {
+        this->bPaused = bPaused;
+    }
+    
+    bool isPaused() const {
+        return bPaused;
+    }
+    
+    long getStepCount() const {
+        return nSteps;
+    }
+    
+    //steps skipped because a frame needed more than maxSubsteps, i.e. how far behind real time we've fallen
+    long getDroppedStepCount() const {
+        return nDroppedSteps;
+    }
+
+};
+
+#endif /* simulationclock_h */
@@ -39,15 +39,19 @@ public:
     
     virtual ~Sphere() = default;
     
+    unsigned int getVAO() const override {
+        return VAO;
+    }
+    
     std::shared_ptr<Shape> clone() override {
         auto retval = std::shared_ptr<Sphere>(new Sphere(*this));
         retval->referenceToThis = retval;
         return retval;
     }
     
-    void render(ShaderProgram shaderProgram) override {
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
+    void render(ShaderProgram& shaderProgram) override {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture);
         glBindVertexArray(VAO);
@@ -55,6 +59,13 @@ public:
         //Shape::renderAABB(getAABB(), shaderProgram);
     }
     
+    void renderInstanced(ShaderProgram& shaderProgram, int nInstances) override {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, nIndices, GL_UNSIGNED_INT, 0, nInstances);
+    }
+    
 };
 
 class SphereFactory : public ShapeFactory
@@ -90,8 +90,8 @@ public:
         return std::shared_ptr<SplineCurve>(new SplineCurve(*this));
     }
     
-    virtual void render(ShaderProgram shaderProgram) {
-        shaderProgram.setMat4("model", modellingTransform);
+    virtual void render(ShaderProgram& shaderProgram) {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
         shaderProgram.setVec3("LineColour", glm::vec3(0.749,0.749,0.));
         shaderProgram.setInt("NumSegments", 16);
         shaderProgram.setInt("NumStrips", 100);
@@ -136,9 +136,9 @@ public:
         return std::shared_ptr<SplineSurface>(new SplineSurface(VAO, VBO, vertices));
     }
     
-    virtual void render(ShaderProgram shaderProgram) {
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
+    virtual void render(ShaderProgram& shaderProgram) {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
         shaderProgram.setInt("TessLevel", 5);
         glBindVertexArray(VAO);
         glPatchParameteri(GL_PATCH_VERTICES, 16);
@@ -168,7 +168,7 @@ public:
         return std::shared_ptr<SplineSurfaceBundle>(new SplineSurfaceBundle(surfaces));
     }
     
-    virtual void render(ShaderProgram shaderProgram) {
+    virtual void render(ShaderProgram& shaderProgram) {
         for (auto& surface : surfaces) {
             surface->render(shaderProgram);
         }
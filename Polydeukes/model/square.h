@@ -42,13 +42,26 @@ public:
     
     virtual ~Square() = default;
     
-    void render(ShaderProgram shaderProgram) override {
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
+    unsigned int getVAO() const override {
+        return VAO;
+    }
+    
+    void render(ShaderProgram& shaderProgram) override {
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     }
     
+    void renderInstanced(ShaderProgram& shaderProgram, int nInstances) override {
+        if (texture) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, texture);
+        }
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, nInstances);
+    }
+    
     std::shared_ptr<Shape> clone() override {
         auto retval = std::shared_ptr<Square>(new Square(*this));
         retval->referenceToThis = retval;
@@ -86,18 +99,16 @@ public:
     
     virtual ~Icon() = default;
     
-    void render(ShaderProgram shaderProgram) override {
-        glm::mat4 meshTransform = glm::inverse(modellingTransform);
+    void render(ShaderProgram& shaderProgram) override {
         modellingTransform = glm::translate(glm::mat4(1.0f), camera->getPosition());
         glm::vec3 direction = glm::vec3(camera->getDirection().x * 10, camera->getDirection().y * 10, camera->getDirection().z * 10);
         modellingTransform = glm::translate(modellingTransform, direction);
         modellingTransform = modellingTransform * glm::inverse(camera->arcballTransformation());
         modellingTransform = glm::translate(modellingTransform, glm::vec3(5.0f, 3.0f - currentCount, 1.0f));
         modellingTransform = glm::scale(modellingTransform, glm::vec3(.5f,.5f,.5f));
-        shaderProgram.setMat4("model", modellingTransform);
-        shaderProgram.setVec3("aColour", colour);
-        glm::mat4 tmp = modellingTransform * meshTransform;
-        mesh.updatePosition(tmp);
+        shaderProgram.set(shaderProgram.model, modellingTransform);
+        shaderProgram.set(shaderProgram.colour, colour);
+        mesh.setTransform(modellingTransform);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture);
         glBindVertexArray(VAO);
@@ -178,7 +178,7 @@ public:
         return retval;
     }
     
-    virtual void render(ShaderProgram shaderProgram) override {
+    virtual void render(ShaderProgram& shaderProgram) override {
         for (int i = 0; i < 32; ++i) {
             characters[i]->render(shaderProgram);
         }
@@ -377,7 +377,7 @@ public:
         });
     }
     
-    void render(ShaderProgram shaderProgram) override {
+    void render(ShaderProgram& shaderProgram) override {
         canvas->render(shaderProgram);
         cursor->render(shaderProgram);
         for (auto& gandc : gandcp) {
@@ -386,6 +386,15 @@ public:
         }
     }
     
+    //everything in the picker's program, the glyphs count as their quads
+    void renderID(ShaderProgram& shaderProgram) override {
+        canvas->renderID(shaderProgram);
+        cursor->renderID(shaderProgram);
+        for (auto& gandc : gandcp) {
+            gandc.fill->renderID(shaderProgram);
+        }
+    }
+    
     std::shared_ptr<Shape> clone() override {
         auto retval = std::shared_ptr<TextBox>(new TextBox(*this));
         retval->referenceToThis = retval;
@@ -0,0 +1,223 @@
+//
+//  threadpool.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef threadpool_h
+#define threadpool_h
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <future>
+#include <memory>
+#include <algorithm>
+
+/*
+ Fixed size pool of worker threads, one per core minus the render thread. Used by the physics step and by the
+ loaders, instead of each of them spinning up its own threads.
+ 
+ Every worker has its own queue. Work a worker queues for itself goes on the back of its own queue and it takes
+ from the back (the most recent, cache warm task), while idle workers steal from the front of someone else's.
+ Work queued from outside the pool (the render thread, a loader) is dealt round robin across the queues.
+ 
+ parallelFor is the one the physics uses: it chops a range into chunks, and the calling thread runs chunks too
+ rather than blocking, so calling it from inside a pool task can't deadlock.
+ */
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks{};
+    };
+    
+    std::vector<std::unique_ptr<WorkQueue>> queues{};
+    std::vector<std::thread> workers{};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> nQueued{0};
+    std::atomic<unsigned int> nextQueue{0};
+    bool bStopping = false;
+    
+    struct WorkerIdentity {
+        ThreadPool* pool = nullptr;
+        int index = -1;
+    };
+    
+    static WorkerIdentity& currentWorker() {
+        thread_local WorkerIdentity identity{};
+        return identity;
+    }
+    
+    //index of the calling thread's queue in this pool, or -1 if it isn't one of our workers
+    int selfIndex() {
+        WorkerIdentity& identity = currentWorker();
+        return identity.pool == this ? identity.index : -1;
+    }
+    
+    void push(std::function<void()> task) {
+        int self = selfIndex();
+        WorkQueue& queue = *queues[self >= 0 ? self : nextQueue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++nQueued;
+        }
+        wake.notify_one();
+    }
+    
+    bool popOwn(int self, std::function<void()>& task) {
+        WorkQueue& queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+    
+    bool steal(int self, std::function<void()>& task) {
+        size_t start = self >= 0 ? self + 1 : 0;
+        for (size_t i = 0; i < queues.size(); ++i) {
+            WorkQueue& queue = *queues[(start + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    bool runOne(int self) {
+        std::function<void()> task;
+        if ((self >= 0 && popOwn(self, task)) || steal(self, task)) {
+            --nQueued;
+            task();
+            return true;
+        }
+        return false;
+    }
+    
+    void workerLoop(int index) {
+        currentWorker() = WorkerIdentity{this, index};
+        while (true) {
+            if (runOne(index)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [&] { return bStopping || nQueued > 0; });
+            if (bStopping) {
+                return;
+            }
+        }
+    }
+
+public:
+    
+    explicit ThreadPool(unsigned int nThreads) {
+        nThreads = std::max(1u, nThreads);
+        for (unsigned int i = 0; i < nThreads; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (unsigned int i = 0; i < nThreads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            bStopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    //the shared pool, leaves a core for the render thread
+    static ThreadPool& getInstance() {
+        static ThreadPool instance(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return instance;
+    }
+    
+    size_t size() const {
+        return workers.size();
+    }
+    
+    template <typename F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::forward<F>(f));
+        auto future = task->get_future();
+        push([task] { (*task)(); });
+        return future;
+    }
+    
+    /*
+     Calls body(chunkBegin, chunkEnd) over [begin, end) in chunks of at least grain and returns once they've all
+     run. Small ranges just run inline.
+     
+     The chunks are claimed off one counter, by the calling thread and by helpers queued on the pool. The caller
+     only ever runs chunks of its own call, never whatever else is queued (a mesh being parsed, a batch of
+     glyphs), so the render thread can't pick up a loader's job mid frame. Waiting is only ever on chunks someone
+     is running, hence no deadlock from inside a pool task either.
+     */
+    template <typename Body>
+    void parallelFor(int begin, int end, int grain, Body&& body) {
+        int n = end - begin;
+        if (n <= 0) {
+            return;
+        }
+        int nChunks = std::min((int)workers.size() + 1, std::max(1, n / std::max(grain, 1)));
+        if (nChunks <= 1) {
+            body(begin, end);
+            return;
+        }
+        //helpers can start after this has returned, they only touch run for a chunk they claimed, and while
+        //there are chunks left to claim this call is still here
+        struct Shared {
+            int nChunks;
+            std::atomic<int> next{0};
+            std::atomic<int> nDone{0};
+            std::function<void(int)> run;
+        };
+        auto shared = std::make_shared<Shared>();
+        shared->nChunks = nChunks;
+        //the remainder spread over the chunks, so they're all grain or more
+        shared->run = [&body, begin, n, nChunks](int chunk) {
+            body(begin + (int)((long long)chunk * n / nChunks), begin + (int)((long long)(chunk + 1) * n / nChunks));
+        };
+        auto claim = [](Shared& state) {
+            for (int chunk = state.next++; chunk < state.nChunks; chunk = state.next++) {
+                state.run(chunk);
+                ++state.nDone;
+            }
+        };
+        for (int helper = 1; helper < nChunks; ++helper) {
+            push([shared, claim] {
+                claim(*shared);
+            });
+        }
+        claim(*shared);
+        while (shared->nDone < nChunks) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+#endif /* threadpool_h */
@@ -0,0 +1,135 @@
+//
+//  transformhierarchy.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef transformhierarchy_h
+#define transformhierarchy_h
+
+#include <glm.hpp>
+#include <vector>
+#include <algorithm>
+
+/*
+ Transforms of a tree of nodes kept flat: node i's parent is at parents[i] < i, and everything under a node sits
+ right after it up to subtreeEnds[i], so a node's subtree is one contiguous range and a forward pass over it sees
+ every parent before its children. Changing a local transform marks that node dirty and update() only walks the
+ ranges under the dirty nodes, so a frame costs what changed rather than the size of the tree.
+ 
+ Nodes are added at the end of their parent's range. Adding to the last open subtree is a push_back, adding
+ anywhere else has to shift everything after it along.
+ */
+class TransformHierarchy {
+private:
+    std::vector<int> parents{};
+    std::vector<int> subtreeEnds{};
+    std::vector<glm::mat4> locals{};
+    std::vector<glm::mat4> worlds{};
+    std::vector<bool> bDirty{};
+    //nodes whose local transform changed since the last update, their subtrees need new world transforms
+    std::vector<int> dirtyRoots{};
+    
+    void markDirty(int node) {
+        if (!bDirty[node]) {
+            bDirty[node] = true;
+            dirtyRoots.push_back(node);
+        }
+    }
+
+public:
+    
+    //parent -1 for a root, returns the new node's index
+    int add(int parent, const glm::mat4& local) {
+        int position = parent < 0 ? (int)parents.size() : subtreeEnds[parent];
+        if (position < (int)parents.size()) {
+            for (int& p : parents) {
+                p += p >= position;
+            }
+            for (int i = position; i < (int)subtreeEnds.size(); ++i) {
+                ++subtreeEnds[i];
+            }
+            for (int& root : dirtyRoots) {
+                root += root >= position;
+            }
+        }
+        parents.insert(parents.begin() + position, parent);
+        subtreeEnds.insert(subtreeEnds.begin() + position, position + 1);
+        locals.insert(locals.begin() + position, local);
+        worlds.insert(worlds.begin() + position, local);
+        bDirty.insert(bDirty.begin() + position, false);
+        for (int ancestor = parent; ancestor >= 0; ancestor = parents[ancestor]) {
+            ++subtreeEnds[ancestor];
+        }
+        markDirty(position);
+        return position;
+    }
+    
+    void clear() {
+        parents.clear();
+        subtreeEnds.clear();
+        locals.clear();
+        worlds.clear();
+        bDirty.clear();
+        dirtyRoots.clear();
+    }
+    
+    int size() const {
+        return (int)parents.size();
+    }
+    
+    int getParent(int node) const {
+        return parents[node];
+    }
+    
+    //one past the last node under this one
+    int getSubtreeEnd(int node) const {
+        return subtreeEnds[node];
+    }
+    
+    const glm::mat4& getLocal(int node) const {
+        return locals[node];
+    }
+    
+    //as of the last update
+    const glm::mat4& getWorld(int node) const {
+        return worlds[node];
+    }
+    
+    void setLocal(int node, const glm::mat4& local) {
+        locals[node] = local;
+        markDirty(node);
+    }
+    
+    bool isDirty() const {
+        return !dirtyRoots.empty();
+    }
+    
+    /*
+     Recomputes the world transforms under every dirty node in one forward pass per range and calls changed(i)
+     for each node that got a new one. A dirty node inside a range already done is skipped.
+     */
+    template <typename Changed>
+    void update(Changed&& changed) {
+        if (dirtyRoots.empty()) {
+            return;
+        }
+        std::sort(dirtyRoots.begin(), dirtyRoots.end());
+        int done = 0;
+        for (int root : dirtyRoots) {
+            if (root < done) {
+                continue;
+            }
+            for (int i = root; i < subtreeEnds[root]; ++i) {
+                worlds[i] = parents[i] < 0 ? locals[i] : worlds[parents[i]] * locals[i];
+                bDirty[i] = false;
+                changed(i);
+            }
+            done = subtreeEnds[root];
+        }
+        dirtyRoots.clear();
+    }
+};
+
+#endif /* transformhierarchy_h */
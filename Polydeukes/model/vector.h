@@ -9,7 +9,14 @@
 #define vector_h
 
 #include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+#include <gtc/type_ptr.hpp>
 #include <cmath>
+#include <limits>
+#include <vector>
+#include <array>
+
+#include "simd.h"
 
 struct Plane {
     glm::vec3 normal;
@@ -28,9 +35,119 @@ struct Triangle {
     
     glm::vec3 a,b,c;
 };
+
+struct RayHit {
+    //distance along the ray, in units of the ray's direction
+    float t = std::numeric_limits<float>::infinity();
+    glm::vec3 position = glm::vec3(0.0f);
+    int primitive = -1;
+};
+
+/*
+ Triangles split into one array per component (the first vertex and the two edges out of it), so the wide
+ ray/triangle test can load simd::width triangles at a time. Build once per mesh, not per ray.
+ */
+struct PackedTriangles {
+    std::vector<float> ax{}, ay{}, az{};
+    std::vector<float> e1x{}, e1y{}, e1z{};
+    std::vector<float> e2x{}, e2y{}, e2z{};
+    
+    PackedTriangles() = default;
+    
+    //every three positions are a triangle, like Mesh and getPositions
+    explicit PackedTriangles(const std::vector<glm::vec3>& positions) {
+        assign(positions);
+    }
+    
+    void assign(const std::vector<glm::vec3>& positions) {
+        size_t n = positions.size() / 3;
+        for (std::vector<float>* component : {&ax, &ay, &az, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z}) {
+            component->resize(n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const glm::vec3& a = positions[3*i];
+            glm::vec3 edge1 = positions[3*i + 1] - a;
+            glm::vec3 edge2 = positions[3*i + 2] - a;
+            ax[i] = a.x; ay[i] = a.y; az[i] = a.z;
+            e1x[i] = edge1.x; e1y[i] = edge1.y; e1z[i] = edge1.z;
+            e2x[i] = edge2.x; e2y[i] = edge2.y; e2z[i] = edge2.z;
+        }
+    }
+    
+    int size() const {
+        return (int)ax.size();
+    }
+};
+
+/*
+ Up to SIZE rays with their components split out, for testing a bundle of rays against the same triangles,
+ e.g. the radial fans the rigging module shoots out of a bone.
+ */
+struct RayPacket {
+    static constexpr int SIZE = 8;
+    std::array<float, SIZE> ox{}, oy{}, oz{};
+    std::array<float, SIZE> dx{}, dy{}, dz{};
+    int count = 0;
+    
+    //false when the packet is already full
+    bool add(const Ray& ray) {
+        if (count == SIZE) {
+            return false;
+        }
+        ox[count] = ray.origin.x; oy[count] = ray.origin.y; oz[count] = ray.origin.z;
+        dx[count] = ray.direction.x; dy[count] = ray.direction.y; dz[count] = ray.direction.z;
+        ++count;
+        return true;
+    }
+    
+    Ray get(int i) const {
+        return Ray{glm::vec3(ox[i], oy[i], oz[i]), glm::vec3(dx[i], dy[i], dz[i])};
+    }
+};
     
 class vector {
   
+private:
+    
+    /*
+     Möller–Trumbore on whole lanes, either one ray against a lane of triangles or a lane of rays against one
+     triangle (the other side broadcast). Same arithmetic in the same order as the scalar version, so they find
+     the same triangles (t can differ in the last bit where the compiler fuses multiply-adds in one and not the
+     other). t comes back as infinity in the lanes that miss or aren't closer than tMax.
+     */
+    template <typename F>
+    static F mollerTrumbore(F ox, F oy, F oz, F dx, F dy, F dz, F ax, F ay, F az, F e1x, F e1y, F e1z, F e2x, F e2y, F e2z, F tMax) {
+        constexpr float epsilon = std::numeric_limits<float>::epsilon();
+        F zero{};
+        F eps = simd::set(epsilon, zero);
+        F negativeEps = simd::set(-epsilon, zero);
+        F one = simd::set(1.0f, zero);
+        //ray_cross_e2
+        F px = simd::sub(simd::mul(dy, e2z), simd::mul(e2y, dz));
+        F py = simd::sub(simd::mul(dz, e2x), simd::mul(e2z, dx));
+        F pz = simd::sub(simd::mul(dx, e2y), simd::mul(e2x, dy));
+        F det = simd::add(simd::add(simd::mul(e1x, px), simd::mul(e1y, py)), simd::mul(e1z, pz));
+        F invDet = simd::div(one, det);
+        F sx = simd::sub(ox, ax);
+        F sy = simd::sub(oy, ay);
+        F sz = simd::sub(oz, az);
+        F u = simd::mul(invDet, simd::add(simd::add(simd::mul(sx, px), simd::mul(sy, py)), simd::mul(sz, pz)));
+        //s_cross_e1
+        F qx = simd::sub(simd::mul(sy, e1z), simd::mul(e1y, sz));
+        F qy = simd::sub(simd::mul(sz, e1x), simd::mul(e1z, sx));
+        F qz = simd::sub(simd::mul(sx, e1y), simd::mul(e1x, sy));
+        F v = simd::mul(invDet, simd::add(simd::add(simd::mul(dx, qx), simd::mul(dy, qy)), simd::mul(dz, qz)));
+        F t = simd::mul(invDet, simd::add(simd::add(simd::mul(e2x, qx), simd::mul(e2y, qy)), simd::mul(e2z, qz)));
+        auto bHit = simd::bitOr(simd::lessEqual(det, negativeEps), simd::lessEqual(eps, det));
+        bHit = simd::bitAnd(bHit, simd::lessEqual(negativeEps, u));
+        bHit = simd::bitAnd(bHit, simd::lessEqual(simd::sub(u, one), eps));
+        bHit = simd::bitAnd(bHit, simd::lessEqual(negativeEps, v));
+        bHit = simd::bitAnd(bHit, simd::lessEqual(simd::sub(simd::add(u, v), one), eps));
+        bHit = simd::bitAnd(bHit, simd::less(eps, t));
+        bHit = simd::bitAnd(bHit, simd::less(t, tMax));
+        return simd::select(bHit, t, simd::set(std::numeric_limits<float>::infinity(), zero));
+    }
+    
 public:
     
     static std::vector<glm::vec3> rayTriangleIntersection(Ray ray, Triangle triangle) {
@@ -69,6 +186,114 @@ public:
         return candidates;
     }
     
+    /*
+     Same test without the vector, for the picker's BVH walk: true (and t, in units of ray.direction) on a hit
+     closer than tMax.
+     */
+    static bool rayTriangleIntersection(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float tMax, float& t) {
+        constexpr float epsilon = std::numeric_limits<float>::epsilon();
+        glm::vec3 edge1 = b - a;
+        glm::vec3 edge2 = c - a;
+        glm::vec3 ray_cross_e2 = cross(ray.direction, edge2);
+        float det = dot(edge1, ray_cross_e2);
+        if (det > -epsilon && det < epsilon) {
+            return false;
+        }
+        float inv_det = 1.0f / det;
+        glm::vec3 s = ray.origin - a;
+        float u = inv_det * dot(s, ray_cross_e2);
+        if ((u < 0 && std::abs(u) > epsilon) || (u > 1 && std::abs(u-1) > epsilon)) {
+            return false;
+        }
+        glm::vec3 s_cross_e1 = cross(s, edge1);
+        float v = inv_det * dot(ray.direction, s_cross_e1);
+        if ((v < 0 && std::abs(v) > epsilon) || (u + v > 1 && std::abs(u + v - 1) > epsilon)) {
+            return false;
+        }
+        float candidate = inv_det * dot(edge2, s_cross_e1);
+        if (candidate <= epsilon || candidate >= tMax) {
+            return false;
+        }
+        t = candidate;
+        return true;
+    }
+    
+    /*
+     Nearest of the triangles hit by the ray closer than tMax, simd::width triangles at a time. Fills in hit (t,
+     position and the triangle's index) and returns true if there is one; nothing is allocated.
+     */
+    static bool rayTriangleIntersection(const Ray& ray, const PackedTriangles& triangles, float tMax, RayHit& hit) {
+        float closest = tMax;
+        int nearest = -1;
+        simd::forEach(triangles.size(), [&](int i, auto lane) {
+            using F = decltype(lane);
+            F t = mollerTrumbore(simd::set(ray.origin.x, lane), simd::set(ray.origin.y, lane), simd::set(ray.origin.z, lane),
+                                 simd::set(ray.direction.x, lane), simd::set(ray.direction.y, lane), simd::set(ray.direction.z, lane),
+                                 simd::load(&triangles.ax[i], lane), simd::load(&triangles.ay[i], lane), simd::load(&triangles.az[i], lane),
+                                 simd::load(&triangles.e1x[i], lane), simd::load(&triangles.e1y[i], lane), simd::load(&triangles.e1z[i], lane),
+                                 simd::load(&triangles.e2x[i], lane), simd::load(&triangles.e2y[i], lane), simd::load(&triangles.e2z[i], lane),
+                                 simd::set(closest, lane));
+            float ts[simd::lanes<F>()];
+            simd::store(ts, t);
+            for (int j = 0; j < simd::lanes<F>(); ++j) {
+                if (ts[j] < closest) {
+                    closest = ts[j];
+                    nearest = i + j;
+                }
+            }
+        });
+        if (nearest < 0) {
+            return false;
+        }
+        hit.t = closest;
+        hit.position = ray.origin + ray.direction * closest;
+        hit.primitive = nearest;
+        return true;
+    }
+    
+    /*
+     Nearest hit closer than tMax for every ray in the packet, the rays simd::width at a time against each
+     triangle in turn. hits[i] is left as a miss (primitive -1) for rays that hit nothing. Returns how many hit.
+     */
+    static int rayPacketIntersection(const RayPacket& packet, const PackedTriangles& triangles, float tMax, std::array<RayHit, RayPacket::SIZE>& hits) {
+        std::array<float, RayPacket::SIZE> closest;
+        std::array<int, RayPacket::SIZE> nearest;
+        closest.fill(tMax);
+        nearest.fill(-1);
+        for (int triangle = 0; triangle < triangles.size(); ++triangle) {
+            simd::forEach(packet.count, [&](int i, auto lane) {
+                using F = decltype(lane);
+                F t = mollerTrumbore(simd::load(&packet.ox[i], lane), simd::load(&packet.oy[i], lane), simd::load(&packet.oz[i], lane),
+                                     simd::load(&packet.dx[i], lane), simd::load(&packet.dy[i], lane), simd::load(&packet.dz[i], lane),
+                                     simd::set(triangles.ax[triangle], lane), simd::set(triangles.ay[triangle], lane), simd::set(triangles.az[triangle], lane),
+                                     simd::set(triangles.e1x[triangle], lane), simd::set(triangles.e1y[triangle], lane), simd::set(triangles.e1z[triangle], lane),
+                                     simd::set(triangles.e2x[triangle], lane), simd::set(triangles.e2y[triangle], lane), simd::set(triangles.e2z[triangle], lane),
+                                     simd::load(&closest[i], lane));
+                float ts[simd::lanes<F>()];
+                simd::store(ts, t);
+                for (int j = 0; j < simd::lanes<F>(); ++j) {
+                    if (ts[j] < closest[i + j]) {
+                        closest[i + j] = ts[j];
+                        nearest[i + j] = triangle;
+                    }
+                }
+            });
+        }
+        int nHits = 0;
+        for (int i = 0; i < RayPacket::SIZE; ++i) {
+            hits[i] = RayHit{};
+            if (i >= packet.count || nearest[i] < 0) {
+                continue;
+            }
+            Ray ray = packet.get(i);
+            hits[i].t = closest[i];
+            hits[i].position = ray.origin + ray.direction * closest[i];
+            hits[i].primitive = nearest[i];
+            ++nHits;
+        }
+        return nHits;
+    }
+    
     static glm::vec3 HalfAngleVector(glm::vec3& light, glm::vec3& eye) {
         return glm::normalize((glm::normalize(light) + glm::normalize(eye)) / 2.0f);
     }
@@ -6,7 +6,13 @@ layout(line_strip, max_vertices = 6) out;
 in vec4 gsPosition[];
 in vec4 gsNormal[];
 
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 
 void GenerateLine(int index)
 {
@@ -2,8 +2,13 @@
 layout (location = 0) in vec3 aPos;
 out vec3 aColour;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 void main() {
     gl_Position = projection * view * model * vec4(aPos,1.0);
     aColour = aPos;
@@ -2,8 +2,13 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 out vec4 FragNormal;
 out vec4 FragPosition;
 void main() {
@@ -4,8 +4,13 @@ layout( quads ) in;
 out vec4 gsNormal; // Vertex normal in camera coords.
 out vec4 gsPosition; // Vertex position in camera coords
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 
 void basisFunctions(out float[4] b, out float[4] db, float t)
 {
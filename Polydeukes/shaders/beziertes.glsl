@@ -1,8 +1,13 @@
 #version 410 core
 layout( isolines ) in;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 
 vec3 decasteljau(float parameterValue, vec3 p0, vec3 p1, vec3 p2, vec3 p3) {
     vec3 firstInterpolatedValue = p1*parameterValue + p0 * (1.f-parameterValue);
@@ -6,8 +6,13 @@ in vec2 texCoord;
 out vec4 FragColor;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 uniform vec2 resolution;
 uniform float threshold;
 uniform sampler2D sdfTexture;
@@ -0,0 +1,37 @@
+#version 410 core
+
+in vec2 fragCoord;
+in vec2 texCoord;
+
+out vec4 FragColor;
+
+uniform mat4 model;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
+uniform vec2 resolution;
+uniform float threshold;
+uniform sampler2D sdfTexture;
+uniform vec3 aColour;
+//em units the channels saturate at either side of the outline
+uniform float distanceRange;
+
+//glyphfs.glsl for a Mode::MSDF font: the distance is the median of the three channels
+float median(float r, float g, float b) {
+    return max(min(r, g), min(max(r, g), b));
+}
+
+void main() {
+    float smoothing = 0.1;
+    vec3 msdf = texture(sdfTexture, texCoord).rgb;
+    float sdfValue = (0.5 - median(msdf.r, msdf.g, msdf.b)) * 2.0 * distanceRange;
+    float alpha = smoothstep(threshold + smoothing, threshold - smoothing, sdfValue);
+    if (alpha < 0.01) {
+        discard;
+    }
+    FragColor = vec4(aColour, alpha);
+}
@@ -6,11 +6,18 @@ out vec2 fragCoord;
 out vec2 texCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 
 uniform vec2 minBounds;
 uniform vec2 maxBounds;
+//where the glyph is in its GlyphAtlas page
+uniform vec4 uvRect;
 uniform float uTime;
 
 uniform vec2 resolution;
@@ -31,6 +38,6 @@ void main() {
     float angle = uTime * speed * 2.0 * 3.14159;
     mat4 rotation = mat4(1.f);
     fragCoord = emPos;
-    texCoord = (emPos - minBounds) / (maxBounds - minBounds);
+    texCoord = mix(uvRect.xy, uvRect.zw, (emPos - minBounds) / (maxBounds - minBounds));
     gl_Position = projection * view * model * rotation * vec4(emPos.x, emPos.y, 0.0, 1.0);
 }
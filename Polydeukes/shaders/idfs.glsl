@@ -0,0 +1,6 @@
+#version 330 core
+layout (location = 0) out uint FragId;
+uniform uint id;
+void main() {
+    FragId = id;
+}
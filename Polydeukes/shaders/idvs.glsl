@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+uniform mat4 model;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
+void main() {
+    gl_Position = projection * view * model * vec4(position,1.0f);
+}
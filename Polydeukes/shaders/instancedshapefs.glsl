@@ -0,0 +1,29 @@
+#version 410 core
+in vec4 FragNormal;
+in vec4 FragPosition;
+out vec4 FragColor;
+in vec2 aTextures;
+flat in vec3 InstanceColour;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
+uniform sampler2D texture1;
+void main() {
+    vec3 fragmentPosition = vec3(FragPosition.x, FragPosition.y, FragPosition.z);
+    vec3 lightVector = normalize(lightPosition - fragmentPosition);
+    vec3 normal = vec3(FragNormal.x, FragNormal.y, FragNormal.z);
+    float ambientStrength = 0.5f;
+    vec3 ambient = ambientStrength * lightColour;
+    //lambertian model
+    float angle = max(dot(normalize(lightVector), normalize(normal)), 0.0f);
+    vec3 diffusion = angle * lightColour;
+    //phong model
+    vec3 halfAngle = normalize((normalize(lightVector) + normalize(eye)) / 2.0f);
+    float phong = max(pow(dot(halfAngle, normal), 1024), 0.0f);
+    vec3 phongModel = phong * lightColour;
+    FragColor = vec4((ambient + diffusion + phongModel) * InstanceColour, 1.0f);
+}
@@ -0,0 +1,24 @@
+#version 410 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 textures;
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in vec3 instanceColour;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
+out vec4 FragNormal;
+out vec4 FragPosition;
+out vec2 aTextures;
+flat out vec3 InstanceColour;
+void main() {
+    gl_Position = projection * view * instanceModel * vec4(position,1.0f);
+    FragPosition = instanceModel * vec4(position,1.0f);
+    FragNormal = normalize(inverse(transpose(instanceModel)) * vec4(normal, 0.0f));
+    aTextures = textures;
+    InstanceColour = instanceColour;
+}
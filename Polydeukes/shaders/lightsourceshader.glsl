@@ -4,9 +4,13 @@ in vec4 FragPosition;
 out vec4 FragColor;
 in vec2 aTextures;
 uniform vec3 aColour;
-uniform vec3 lightPosition;
-uniform vec3 eye;
-uniform vec3 lightColour;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 uniform sampler2D texture1;
 void main() {
     FragColor = vec4(1.0, 1.0, 1.0, .1);
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 textures;
+layout (location = 3) in float instanceX;
+layout (location = 4) in float instanceY;
+layout (location = 5) in float instanceZ;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
+uniform mat4 model;
+out vec4 FragNormal;
+out vec4 FragPosition;
+out vec2 aTextures;
+void main() {
+    vec4 worldPosition = model * vec4(position,1.0f) + vec4(instanceX, instanceY, instanceZ, 0.0f);
+    gl_Position = projection * view * worldPosition;
+    FragPosition = worldPosition;
+    FragNormal = normalize(inverse(transpose(model)) * vec4(normal, 0.0f));
+    aTextures = textures;
+}
@@ -9,7 +9,13 @@ in vec4 gsNormal[];
 out vec4 FragPosition;
 out vec4 FragNormal;
 
-uniform mat4 projection;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightColour;
+    vec3 lightPosition;
+    vec3 eye;
+};
 
 
 void main() {
@@ -0,0 +1,220 @@
+//
+//  pickingbuffer.h
+//  Polydeukes
+//
+//  Created by Lawrence Berardelli on 2026-10-16.
+//
+
+#ifndef pickingbuffer_h
+#define pickingbuffer_h
+
+#include "../model/shape.h"
+#include "../model/ShaderProgram.h"
+#include "screenheight.h"
+
+#include <glad/glad.h>
+#include <glm.hpp>
+#include <vector>
+#include <memory>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+/*
+ Picking on the GPU instead of casting rays on the CPU. Every scene shape is drawn into an offscreen integer
+ buffer as its index + 1 (0 is nothing), with depth, and only the pixel under the cursor is read back. The cost
+ depends on the pixels drawn rather than the triangle count, which is what hurts the ray picker on the big OBJs
+ and the glyph menus.
+ 
+ Reading a pixel straight back would stall until the GPU caught up, so the read goes into a pixel buffer with a
+ fence behind it and gets picked up on a later frame once the fence has passed (usually the next one). Two
+ buffers so this frame's read never waits on last frame's. Each read keeps the shape table and the matrices it
+ was drawn with, so the answer matches the frame it came from even if the scene has changed since.
+ 
+ The id goes in the colour attachment and the depth comes back alongside it, so the exact world position is the
+ pixel unprojected at that depth.
+ */
+class PickingBuffer {
+public:
+    
+    struct Pick {
+        std::shared_ptr<Shape> shape{};
+        glm::vec3 position{};
+    };
+
+private:
+    
+    struct Readback {
+        unsigned int pbo = 0;
+        GLsync fence = nullptr;
+        //pixel in the buffer, origin bottom left
+        int x = 0;
+        int y = 0;
+        int width = 1;
+        int height = 1;
+        glm::mat4 inverseViewProjection{1.0f};
+        std::vector<std::weak_ptr<Shape>> shapes{};
+    };
+    
+    ShaderProgram* idProgram;
+    Uniform<unsigned int> id{};
+    unsigned int fbo = 0;
+    unsigned int idRenderbuffer = 0;
+    unsigned int depthRenderbuffer = 0;
+    int width = 0;
+    int height = 0;
+    std::array<Readback, 2> readbacks{};
+    int nextReadback = 0;
+    
+    void allocate(int width, int height) {
+        if (fbo == 0) {
+            glGenFramebuffers(1, &fbo);
+            glGenRenderbuffers(1, &idRenderbuffer);
+            glGenRenderbuffers(1, &depthRenderbuffer);
+            for (Readback& readback : readbacks) {
+                glGenBuffers(1, &readback.pbo);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+                //the id then the depth
+                glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint) + sizeof(GLfloat), nullptr, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        this->width = width;
+        this->height = height;
+        glBindRenderbuffer(GL_RENDERBUFFER, idRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, idRenderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "picking framebuffer is incomplete" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    
+    void release(Readback& readback) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+            readback.fence = nullptr;
+        }
+    }
+    
+    bool isReady(const Readback& readback) const {
+        if (!readback.fence) {
+            return false;
+        }
+        GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    }
+    
+    Pick read(const Readback& readback) const {
+        GLuint pickedId = 0;
+        GLfloat depth = 1.0f;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint) + sizeof(GLfloat), GL_MAP_READ_BIT);
+        if (data) {
+            std::memcpy(&pickedId, data, sizeof(GLuint));
+            std::memcpy(&depth, (char*)data + sizeof(GLuint), sizeof(GLfloat));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        Pick pick{};
+        if (pickedId == 0 || pickedId > readback.shapes.size()) {
+            return pick;
+        }
+        pick.shape = readback.shapes[pickedId - 1].lock();
+        //back through the matrices the frame was drawn with, from the centre of the pixel
+        glm::vec4 ndc((readback.x + 0.5f) / readback.width * 2.0f - 1.0f, (readback.y + 0.5f) / readback.height * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+        glm::vec4 world = readback.inverseViewProjection * ndc;
+        pick.position = glm::vec3(world.x, world.y, world.z) / world.w;
+        return pick;
+    }
+
+public:
+    
+    //idProgram is idvs.glsl/idfs.glsl, already initialized
+    explicit PickingBuffer(ShaderProgram* idProgram) : idProgram(idProgram) {
+        id = idProgram->getUniform<unsigned int>("id");
+    }
+    
+    ~PickingBuffer() {
+        for (Readback& readback : readbacks) {
+            release(readback);
+            glDeleteBuffers(1, &readback.pbo);
+        }
+        glDeleteRenderbuffers(1, &idRenderbuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteFramebuffers(1, &fbo);
+    }
+    
+    PickingBuffer(const PickingBuffer&) = delete;
+    PickingBuffer& operator=(const PickingBuffer&) = delete;
+    
+    /*
+     Draws the shapes' ids and queues the read of the pixel under the cursor (window coordinates, like the
+     cursor callbacks get). Call from inside the frame, with the frame's view and projection.
+     */
+    void render(const std::vector<std::shared_ptr<Shape>>& shapes, const glm::mat4& view, const glm::mat4& projection, int mouseX, int mouseY) {
+        if (width != (int)ScreenHeight::screen_width || height != (int)ScreenHeight::screen_height) {
+            allocate(ScreenHeight::screen_width, ScreenHeight::screen_height);
+        }
+        Readback& readback = readbacks[nextReadback];
+        //never collected, it's stale by now anyway
+        release(readback);
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        const GLuint nothing[4] = {0, 0, 0, 0};
+        glClearBufferuiv(GL_COLOR, 0, nothing);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        idProgram->bind();
+        for (size_t i = 0; i < shapes.size(); ++i) {
+            idProgram->set(id, (unsigned int)(i + 1));
+            shapes[i]->renderID(*idProgram);
+        }
+        readback.x = std::clamp(mouseX, 0, width - 1);
+        readback.y = std::clamp(height - 1 - mouseY, 0, height - 1);
+        readback.width = width;
+        readback.height = height;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(readback.x, readback.y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+        glReadPixels(readback.x, readback.y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)sizeof(GLuint));
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        readback.inverseViewProjection = glm::inverse(projection * view);
+        readback.shapes.assign(shapes.begin(), shapes.end());
+        nextReadback = (nextReadback + 1) % (int)readbacks.size();
+    }
+    
+    /*
+     The newest read the GPU has finished, if there's one we haven't collected yet. pick.shape is empty when the
+     cursor was over nothing. Older reads are dropped once a newer one lands.
+     */
+    bool resolve(Pick& pick) {
+        int nReadbacks = (int)readbacks.size();
+        for (int age = 1; age <= nReadbacks; ++age) {
+            Readback& readback = readbacks[(nextReadback + nReadbacks - age) % nReadbacks];
+            if (!isReady(readback)) {
+                continue;
+            }
+            pick = read(readback);
+            for (int older = age; older <= nReadbacks; ++older) {
+                release(readbacks[(nextReadback + nReadbacks - older) % nReadbacks]);
+            }
+            return true;
+        }
+        return false;
+    }
+
+};
+
+#endif /* pickingbuffer_h */
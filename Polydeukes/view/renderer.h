@@ -18,6 +18,12 @@
 #include "../model/square.h"
 #include "../model/particle.h"
 #include "../model/sphere.h"
+#include "../model/broadphase.h"
+#include "../model/particlesystem.h"
+#include "../model/threadpool.h"
+#include "../model/simulationclock.h"
+#include "../model/frustum.h"
+#include "../model/assetstreamer.h"
 #include "screenheight.h"
 
 #include <glad/glad.h>
@@ -28,8 +34,11 @@
 #include <algorithm>
 #include <chrono>
 #include <thread>
+#include <mutex>
 #include <stack>
 #include <random>
+#include <tuple>
+#include <unordered_map>
 
 
 class Renderer {
@@ -43,9 +52,22 @@ private:
      */
     Scene* theScene;
     std::vector<Particle> particles{};
+    std::vector<std::shared_ptr<ParticleSystem>> particleSystems{};
+    //physics and animation step off this, decoupled from the frame rate
+    SimulationClock clock{1.0 / 60.0};
+    std::chrono::high_resolution_clock::time_point lastFrameTime{};
+    //where each moving particle's shape is drawn this frame, relative to where it is
+    std::unordered_map<Shape*, glm::mat4> interpolatedOffsets{};
     glm::mat4 view;
     glm::mat4 projection = glm::perspective(glm::radians(fov), (float)ScreenHeight::screen_width / (float)ScreenHeight::screen_height, .1f, 500.0f);
     std::function<void()> preRenderCustomization = [] {};
+    //drawn into other framebuffers each frame before the scene, e.g. the GPU picker
+    std::function<void()> offscreenPass = [] {};
+    //handed over from other threads, run at the top of the next frame
+    std::vector<std::function<void()>> renderThreadTasks{};
+    std::mutex renderThreadTasksMutex;
+    //textures and meshes loading in the background, uploaded a slice at a time at the top of each frame
+    AssetStreamer streamer{};
     static float fov;
     
     struct RenderPackage {
@@ -54,10 +76,98 @@ private:
         //Need to inject viewing data into each render call somehow... like the render call traverses the tree but render data is only
         //Set at the top node.
         std::vector<ShaderProgram*> programs{};
+        
+        std::tuple<unsigned int, unsigned int, unsigned int> sortKey() const {
+            if (shape == nullptr || programs.size() == 0 || programs[0] == nullptr) {
+                return {0, 0, 0};
+            }
+            return {programs[0]->pid, shape->getVAO(), shape->getTexture()};
+        }
+    };
+    
+    /*
+     Counters for a single pass over the render queue. A change is a transition between adjacent packages,
+     so these are the binds the driver actually sees once the queue is sorted and redundant binds are skipped.
+     */
+    struct FrameStats {
+        int packages = 0;
+        int programChanges = 0;
+        int vaoChanges = 0;
+        int textureChanges = 0;
+        int uniformUploads = 0;
+        //packages left out whole by the frustum test, and parts of composite shapes (SceneList children)
+        int packagesCulled = 0;
+        int partsCulled = 0;
+        //asked of the streamer and not on the GPU yet
+        int assetsPending = 0;
+        
+        int stateChanges() const {
+            return programChanges + vaoChanges + textureChanges;
+        }
     };
     
     ShaderProgram* defaultProgram;
     std::vector<RenderPackage> instructions{};
+    std::vector<ShaderProgram*> programsInQueue{};
+    bool bQueueDirty = true;
+    FrameStats frameStats{};
+    bool bReportFrameStats = false;
+    //this frame's, in world space
+    Frustum frustum{};
+    bool bFrustumCulling = true;
+    FrameDataBlock frameData{};
+    std::unique_ptr<Broadphase> broadphase = std::make_unique<SpatialHashBroadphase>();
+    std::vector<AABB> particleBoxes{};
+    std::vector<std::pair<int, int>> candidatePairs{};
+    
+    void runRenderThreadTasks() {
+        std::vector<std::function<void()>> tasks{};
+        {
+            std::lock_guard<std::mutex> lock(renderThreadTasksMutex);
+            tasks.swap(renderThreadTasks);
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+    }
+    
+    /*
+     Most to least expensive context switch: program, then vertex array, then texture. Stable so that
+     packages sharing all three still draw in insertion order (the tile editors rely on painter's order).
+     */
+    void sortRenderQueue() {
+        std::stable_sort(instructions.begin(), instructions.end(), [](const RenderPackage& lhs, const RenderPackage& rhs) {
+            return lhs.sortKey() < rhs.sortKey();
+        });
+        programsInQueue.clear();
+        for (RenderPackage& package : instructions) {
+            for (ShaderProgram* program : package.programs) {
+                if (program != nullptr && std::find(programsInQueue.begin(), programsInQueue.end(), program) == programsInQueue.end()) {
+                    programsInQueue.push_back(program);
+                }
+            }
+        }
+        bQueueDirty = false;
+    }
+    
+    /*
+     Whole packages by their cached world box, then composite shapes test their own parts (hierarchically, a
+     part only gets tested if what holds it is partly in view). Shapes without a box are always drawn.
+     */
+    bool isCulled(RenderPackage& package) {
+        if (!bFrustumCulling) {
+            package.shape->cullParts(frustum, Containment::INSIDE);
+            return false;
+        }
+        std::vector<glm::vec3> aabb = package.shape->getAABB();
+        Containment containment = aabb.size() < 2 ? Containment::PARTIAL : frustum.classify(AABB(aabb));
+        if (containment == Containment::OUTSIDE) {
+            ++frameStats.packagesCulled;
+            return true;
+        }
+        frameStats.partsCulled += package.shape->cullParts(frustum, containment);
+        return false;
+    }
     
     bool areColliding(std::vector<glm::vec3> aabb1, std::vector<glm::vec3> aabb2) {
         // Check overlap on x-axis
@@ -94,6 +204,19 @@ public:
         this->preRenderCustomization = customization;
     }
     
+    void setOffscreenPass(std::function<void()> pass) {
+        this->offscreenPass = pass;
+    }
+    
+    /*
+     For background jobs to get results into the scene: the task runs on the render thread at the start of the
+     next frame, where it's safe to add meshes and touch GL. Safe to call from any thread.
+     */
+    void runOnRenderThread(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(renderThreadTasksMutex);
+        renderThreadTasks.push_back(std::move(task));
+    }
+    
     glm::mat4 getViewingTransform() {
         return view;
     }
@@ -102,6 +225,35 @@ public:
         return projection;
     }
     
+    void setBroadphase(std::unique_ptr<Broadphase> broadphase) {
+        this->broadphase = std::move(broadphase);
+    }
+    
+    SimulationClock& getClock() {
+        return clock;
+    }
+    
+    //for loadTexture/loadObj, render thread only
+    AssetStreamer& getStreamer() {
+        return streamer;
+    }
+    
+    BroadphaseStats getBroadphaseStats() const {
+        return broadphase->getStats();
+    }
+    
+    FrameStats getFrameStats() const {
+        return frameStats;
+    }
+    
+    void reportFrameStats(bool bReport) {
+        bReportFrameStats = bReport;
+    }
+    
+    void setFrustumCulling(bool bCull) {
+        bFrustumCulling = bCull;
+    }
+    
     std::shared_ptr<Shape> getShape(Shape* shape) {
         for (auto&& theshape : theScene->get()) {
             if (theshape.get() == shape) {
@@ -117,6 +269,7 @@ public:
         }
         RenderPackage package{shape, {program}};
         instructions.push_back(package);
+        bQueueDirty = true;
         theScene->addMesh(shape);
     }
     
@@ -126,6 +279,7 @@ public:
         }
         RenderPackage package{shape, programs};
         instructions.push_back(package);
+        bQueueDirty = true;
         theScene->addMesh(shape);
     }
     
@@ -145,7 +299,9 @@ public:
             }
         }
         particles = tmp;
+        particleSystems.erase(std::remove(particleSystems.begin(), particleSystems.end(), shape), particleSystems.end());
         instructions = std::vector<RenderPackage>(instructions.begin(), it);
+        bQueueDirty = true;
     }
     
     void addParticle(Particle particle) {
@@ -157,78 +313,181 @@ public:
         particles.push_back(particle);
     }
     
+    /*
+     Bulk particles (see particlesystem.h). Stepped alongside the individual particles but they don't take
+     part in the broadphase, a million of them would swamp it.
+     */
+    void addParticleSystem(std::shared_ptr<ParticleSystem> system, ShaderProgram* program) {
+        addMesh(system, program);
+        particleSystems.push_back(system);
+    }
+    
     bool isOutsideBoundary(Particle& particle) {
         return glm::length(particle.getPosition()) > 50;
     }
     
     /*
-     TODO: Need to couple the shading program and the object in the scene
-     This is related to the rendering data package as in the shading program could be in the rendering package.
-     Though that would lead to a bind call on the shading program for every render call. In fact, that is
-     bad according to top answer https://www.reddit.com/r/opengl/comments/3etkgc/performance_costs_of_switching_shaders_between/
-     so we will need an appropriate solution, probably not switching shaders at all until necessary.
-     
-     TODO: Need to sort the items of the scene to minimize context switching. 
+     The particles' shapes hold the latest step, but the frame falls between that and the one before. Moving
+     particles are drawn pulled back along their last step: the offset goes in front of the model matrix at
+     draw time (ShaderProgram::modelOffset) so the shapes themselves never move, and composite shapes (a
+     SceneList) take their children with them.
+     */
+    void computeInterpolatedOffsets() {
+        interpolatedOffsets.clear();
+        float lag = 1.0f - clock.getInterpolation();
+        if (lag <= 0.0f) {
+            return;
+        }
+        for (Particle& particle : particles) {
+            glm::vec3 displacement = particle.getLastDisplacement();
+            if (displacement == glm::vec3(0.0f)) {
+                continue;
+            }
+            interpolatedOffsets[particle.getShape().get()] = glm::translate(glm::mat4(1.0f), -lag * displacement);
+        }
+    }
+    
+    /*
+     One fixed physics step. Gathering boxes, the broadphase and the particle updates are split across the
+     shared pool; each particle only touches its own shape (and its own spring's coil) so the updates are
+     independent. Removing particles edits the scene and the queue so it stays on this thread.
+     */
+    void stepPhysics(float deltaTime) {
+        ThreadPool& pool = ThreadPool::getInstance();
+        //broadphase on the cached boxes, the narrowphase is still just a bounce
+        particleBoxes.resize(particles.size());
+        pool.parallelFor(0, (int)particles.size(), 64, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                particleBoxes[i] = AABB(particles[i].getShape()->getAABB());
+            }
+        });
+        broadphase->computePairs(particleBoxes, candidatePairs);
+        for (auto& pair : candidatePairs) {
+            particles[pair.first].basicCollision();
+            particles[pair.second].basicCollision();
+        }
+        
+        pool.parallelFor(0, (int)particles.size(), 64, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                particles[i].update(deltaTime);
+            }
+        });
+        for (auto& system : particleSystems) {
+            system->step(deltaTime);
+            system->removeOutside(50);
+        }
+        
+        for (std::vector<Particle>::iterator it = particles.begin(); it != particles.end();) {
+            if (isOutsideBoundary(*it)) {
+                removeShape(it->getShape());
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    
+    /*
+     The shading program lives in the render package, and the queue is kept sorted by (program, vao, texture)
+     so that we only switch shaders when we have to
+     (https://www.reddit.com/r/opengl/comments/3etkgc/performance_costs_of_switching_shaders_between/).
+     Per-frame uniforms go into the shared FrameData block once per frame; only programs whose shaders
+     don't declare the block get them uploaded individually (still once per program, not per package).
      */
     void buildandrender(GLFWwindow* window, Camera* camera, Scene* theScene) {
         this->theScene = theScene;
         defaultProgram->setInt("texture1", 0);
         light light(glm::vec3(1.0,1.0,1.0), glm::vec3(0.0, 150.0, 150.0));
         //addMesh(CubeBuilder().withPosition(light.position).withColour(glm::vec3(1.0f,1.0f,1.0f)).build());
-        ShaderProgram* previousProgram = 0;
-        double framerate = 60;
         int i = 1;
+        if (!frameData.isInitialized()) {
+            frameData.init();
+        }
         SphereBuilder::getInstance()->withPosition(glm::vec3(-10.0f,0.0f,0.0f)).withColour(glm::vec3(1.0f,1.0f,1.0f));
         auto start = std::chrono::high_resolution_clock::now();
+        lastFrameTime = start;
         while (!glfwWindowShouldClose(window)) {
+            runRenderThreadTasks();
+            //shapes that just became resident have new VAOs to sort by
+            if (streamer.pump() > 0) {
+                bQueueDirty = true;
+            }
             preRenderCustomization();
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glEnable(GL_DEPTH_TEST);
             view = camera->viewingTransformation();
             glm::vec3 cameraPosition = camera->getPosition();
+            if (bQueueDirty) {
+                sortRenderQueue();
+            }
+            frameStats = FrameStats{};
+            frameStats.assetsPending = streamer.getPendingCount();
+            frustum = Frustum(projection * view);
+            frameData.update(view, projection, light.colour, light.position, cameraPosition);
+            ++frameStats.uniformUploads;
+            for (ShaderProgram* program : programsInQueue) {
+                if (program->usesFrameData()) {
+                    continue;
+                }
+                if (!program->isBound()) {
+                    program->bind();
+                    ++frameStats.programChanges;
+                }
+                program->setMat4("view", view);
+                program->setMat4("projection", projection);
+                
+                //set the lighting uniforms
+                //program.setVec3("aColour", glm::vec3(1.0f, 0.5f, 0.31f));
+                program->setVec3("lightColour", light.colour);
+                program->setVec3("lightPosition", light.position);
+                program->setVec3("eye", cameraPosition);
+                frameStats.uniformUploads += 5;
+            }
+            computeInterpolatedOffsets();
+            offscreenPass();
+            std::tuple<unsigned int, unsigned int, unsigned int> previousKey{0, 0, 0};
             for (RenderPackage& package : instructions) {
                 if (package.shape == nullptr || package.programs.size() == 0 || package.programs[0] == nullptr) {
                     std::cout << "WTF" << std::endl;
                     continue;
                 }
-                for (auto& program : package.programs) {
-                    program->bind();
-                    program->setMat4("view", view);
-                    program->setMat4("projection", projection);
-                    
-                    //set the lighting uniforms
-                    //program.setVec3("aColour", glm::vec3(1.0f, 0.5f, 0.31f));
-                    program->setVec3("lightColour", light.colour);
-                    program->setVec3("lightPosition", light.position);
-                    program->setVec3("eye", cameraPosition);
-                    previousProgram = program;
+                if (isCulled(package)) {
+                    continue;
                 }
-                package.programs[0]->bind();
-                package.shape->render(*package.programs[0]);
-            }
-            std::vector<collision> collisions{};
-            for (int i = 0; i < particles.size(); ++i) {
-                for (int j = i; j < particles.size(); ++j) {
-                    if (areColliding(particles[i].getShape()->getAABB(), particles[j].getShape()->getAABB())) {
-                        particles[i].basicCollision();
-                        particles[j].basicCollision();
-                    }
+                auto key = package.sortKey();
+                //glyphs only get a vao on their first render and textures can be swapped, so resort next frame if we're out of order
+                if (key < previousKey) {
+                    bQueueDirty = true;
                 }
-            }
-            
-            for (Particle& particle : particles) {
-                particle.update(float(1)/(float) framerate);
-            }
-            
-            for (std::vector<Particle>::iterator it = particles.begin(); it != particles.end();) {
-                if (isOutsideBoundary(*it)) {
-                    removeShape(it->getShape());
+                if (!package.programs[0]->isBound()) {
+                    package.programs[0]->bind();
+                    ++frameStats.programChanges;
+                }
+                if (std::get<1>(key) != std::get<1>(previousKey)) ++frameStats.vaoChanges;
+                if (std::get<2>(key) != std::get<2>(previousKey)) ++frameStats.textureChanges;
+                previousKey = key;
+                ++frameStats.packages;
+                package.shape->updateView(view, projection, ScreenHeight::screen_height);
+                auto interpolated = interpolatedOffsets.find(package.shape.get());
+                if (interpolated != interpolatedOffsets.end()) {
+                    ShaderProgram::modelOffset() = interpolated->second;
+                    package.shape->render(*package.programs[0]);
+                    ShaderProgram::modelOffset() = glm::mat4(1.0f);
                 }
                 else {
-                    ++it;
+                    package.shape->render(*package.programs[0]);
                 }
             }
+            //physics catches up with the wall clock in fixed steps, however long the frame took
+            auto now = std::chrono::high_resolution_clock::now();
+            clock.advance(std::chrono::duration<double>(now - lastFrameTime).count(), [&](float deltaTime) {
+                stepPhysics(deltaTime);
+            });
+            lastFrameTime = now;
+            for (auto& system : particleSystems) {
+                system->setInterpolation(clock.getInterpolation());
+            }
             
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> duration = end - start;
@@ -239,6 +498,12 @@ public:
             }
             if (i % 10 == 0) {
                 //std::cout << "framerate: " << 1.f/frameTime << std::endl;
+                if (bReportFrameStats) {
+                    std::cout << "packages drawn: " << frameStats.packages << " culled: " << frameStats.packagesCulled << " (+" << frameStats.partsCulled << " parts) state changes: " << frameStats.stateChanges()
+                              << " (programs " << frameStats.programChanges << ", vaos " << frameStats.vaoChanges
+                              << ", textures " << frameStats.textureChanges << ") uniform uploads: " << frameStats.uniformUploads
+                              << " streaming: " << frameStats.assetsPending << std::endl;
+                }
                 i = 0;
             }
             ++i;